@@ -0,0 +1,335 @@
+#include "include/fast_face_sdk.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+
+// 性能测试程序
+// 用法: benchmark_sdk [视频文件]
+// 未指定视频文件时使用合成图像；结果建议重定向到 bench_output.txt
+
+static const char* LICENSE_KEY = "FAST_FACE_2024_LICENSE_KEY_12345";
+
+// 生成合成测试帧：噪声背景上绘制若干“人脸”
+static std::vector<cv::Mat> make_synthetic_frames(int width, int height, int count) {
+    std::vector<cv::Mat> frames;
+    cv::RNG rng(12345);
+    for (int i = 0; i < count; ++i) {
+        cv::Mat frame(height, width, CV_8UC3);
+        rng.fill(frame, cv::RNG::UNIFORM, cv::Scalar(60, 60, 60), cv::Scalar(180, 180, 180));
+        int radius = height / 8;
+        for (int f = 0; f < 3; ++f) {
+            cv::Point center(width / 4 * (f + 1) + (i % 5), height / 2 + (i % 3));
+            cv::circle(frame, center, radius, cv::Scalar(150, 180, 220), -1);
+            cv::circle(frame, center + cv::Point(-radius / 3, -radius / 4), radius / 8, cv::Scalar(0, 0, 0), -1);
+            cv::circle(frame, center + cv::Point(radius / 3, -radius / 4), radius / 8, cv::Scalar(0, 0, 0), -1);
+            cv::ellipse(frame, center + cv::Point(0, radius / 3), cv::Size(radius / 3, radius / 6), 0, 0, 180, cv::Scalar(0, 0, 0), 2);
+        }
+        frames.push_back(frame);
+    }
+    return frames;
+}
+
+// 从视频文件读取帧并缩放到指定尺寸
+static std::vector<cv::Mat> load_recorded_frames(const std::string& path, int width, int height, int count) {
+    std::vector<cv::Mat> frames;
+    cv::VideoCapture cap(path);
+    cv::Mat frame;
+    while ((int)frames.size() < count && cap.read(frame)) {
+        cv::Mat resized;
+        cv::resize(frame, resized, cv::Size(width, height));
+        frames.push_back(resized);
+    }
+    return frames;
+}
+
+// 批量分析吞吐量（帧/秒）
+static double measure_batch_throughput(const std::vector<cv::Mat>& frames, int rounds) {
+    std::vector<FfFrameDesc> descs(frames.size());
+    std::vector<FfJsonOutput> outputs(frames.size());
+    std::vector<std::vector<char>> buffers(frames.size(), std::vector<char>(FastFaceConfig::MAX_JSON_BUFFER_SIZE * 4));
+    for (size_t i = 0; i < frames.size(); ++i) {
+        descs[i] = {frames[i].data, frames[i].cols, frames[i].rows, -1, nullptr};
+        outputs[i] = {buffers[i].data(), (int)buffers[i].size(), 0, 0};
+    }
+
+    // 预热：创建各工作线程的会话
+    analyze_frames(descs.data(), (int)descs.size(), outputs.data());
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        int result = analyze_frames(descs.data(), (int)descs.size(), outputs.data());
+        if (result != 0) {
+            std::cout << "批量分析失败，错误代码: " << result << std::endl;
+            return 0.0;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return frames.size() * rounds / seconds;
+}
+
+// 新建会话的默认参数
+static FfSessionParams default_session_params() {
+    FfSessionParams params = {};
+    FfSession* session = nullptr;
+    if (ff_session_create(&session) == 0) {
+        ff_session_get_params(session, &params);
+        ff_session_destroy(session);
+    }
+    return params;
+}
+
+// 单会话逐帧分析，记录每帧的人脸结果（用于计算召回率和误差）
+static double measure_session_fps(const std::vector<cv::Mat>& frames, const FfSessionParams& params,
+                                  std::vector<std::vector<FfFaceResult>>& results) {
+    FfSession* session = nullptr;
+    if (ff_session_create(&session) != 0) return 0.0;
+    ff_session_set_params(session, &params);
+
+    FfFaceResult faces[FastFaceConfig::MAX_FACES_PER_FRAME];
+    results.assign(frames.size(), std::vector<FfFaceResult>());
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < frames.size(); ++i) {
+        FfImage image = {FF_PIXEL_BGR, frames[i].cols, frames[i].rows, {frames[i].data}, {0}};
+        int face_count = 0;
+        ff_session_analyze_ex(session, &image, faces, FastFaceConfig::MAX_FACES_PER_FRAME, &face_count);
+        for (int f = 0; f < std::min(face_count, FastFaceConfig::MAX_FACES_PER_FRAME); ++f) {
+            results[i].push_back(faces[f]);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ff_session_destroy(session);
+    return frames.size() / seconds;
+}
+
+// 以原分辨率检测结果为基准的召回率（IoU >= 0.5 视为命中）
+static double compute_recall(const std::vector<std::vector<FfFaceResult>>& reference,
+                             const std::vector<std::vector<FfFaceResult>>& results) {
+    int total = 0, matched = 0;
+    for (size_t i = 0; i < reference.size(); ++i) {
+        for (const FfFaceResult& ref : reference[i]) {
+            ++total;
+            cv::Rect a(ref.bbox.x, ref.bbox.y, ref.bbox.width, ref.bbox.height);
+            for (const FfFaceResult& face : results[i]) {
+                cv::Rect b(face.bbox.x, face.bbox.y, face.bbox.width, face.bbox.height);
+                double overlap = (a & b).area();
+                if (overlap / (a.area() + b.area() - overlap) >= 0.5) {
+                    ++matched;
+                    break;
+                }
+            }
+        }
+    }
+    return total > 0 ? matched / (double)total : 1.0;
+}
+
+// 运动幅度相对基准的平均绝对误差（只比较人脸框相同的人脸）
+static double compute_motion_error(const std::vector<std::vector<FfFaceResult>>& reference,
+                                   const std::vector<std::vector<FfFaceResult>>& results) {
+    double total = 0.0;
+    int count = 0;
+    for (size_t i = 0; i < reference.size(); ++i) {
+        for (const FfFaceResult& ref : reference[i]) {
+            for (const FfFaceResult& face : results[i]) {
+                if (face.bbox.x == ref.bbox.x && face.bbox.y == ref.bbox.y &&
+                    face.bbox.width == ref.bbox.width && face.bbox.height == ref.bbox.height) {
+                    total += std::abs(face.motion_blur - ref.motion_blur);
+                    ++count;
+                    break;
+                }
+            }
+        }
+    }
+    return count > 0 ? total / count : 0.0;
+}
+
+int main(int argc, char** argv) {
+    std::string video_path = argc > 1 ? argv[1] : "";
+
+    std::cout << "FastFaceSDK 性能测试" << std::endl;
+    std::cout << "=================================" << std::endl;
+    std::cout << "SDK版本: " << get_sdk_version() << std::endl;
+    std::cout << "CPU核心数: " << std::thread::hardware_concurrency() << std::endl;
+    std::cout << "测试数据: " << (video_path.empty() ? "合成图像" : video_path) << std::endl;
+
+    int init_result = sdk_init(LICENSE_KEY);
+    if (init_result != 0) {
+        std::cout << "SDK初始化失败，错误代码: " << init_result << std::endl;
+        return -1;
+    }
+
+    const cv::Size resolutions[] = {cv::Size(640, 480), cv::Size(1920, 1080)};
+    const int batch_size = 32;
+    const int rounds = 3;
+
+    int max_threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> thread_counts;
+    for (int t = 1; t < max_threads; t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+
+    std::cout << "\n=== 批量分析吞吐量 (analyze_frames, 批大小 " << batch_size << ") ===" << std::endl;
+    std::cout << std::left << std::setw(12) << "分辨率" << std::setw(10) << "线程数"
+              << std::setw(14) << "帧/秒" << "加速比" << std::endl;
+
+    for (const auto& resolution : resolutions) {
+        std::vector<cv::Mat> frames = video_path.empty()
+            ? make_synthetic_frames(resolution.width, resolution.height, batch_size)
+            : load_recorded_frames(video_path, resolution.width, resolution.height, batch_size);
+        if (frames.empty()) {
+            std::cout << "无法读取测试帧" << std::endl;
+            break;
+        }
+
+        double baseline = 0.0;
+        for (int threads : thread_counts) {
+            ff_set_worker_threads(threads);
+            double fps = measure_batch_throughput(frames, rounds);
+            if (baseline == 0.0) baseline = fps;
+
+            std::string label = std::to_string(resolution.width) + "x" + std::to_string(resolution.height);
+            std::cout << std::left << std::setw(12) << label << std::setw(10) << threads
+                      << std::setw(14) << std::fixed << std::setprecision(1) << fps
+                      << std::setprecision(2) << (baseline > 0.0 ? fps / baseline : 0.0) << "x" << std::endl;
+        }
+    }
+    ff_set_worker_threads(FastFaceConfig::WORKER_THREADS);
+
+    // 检测缩放比例的速度/召回率（以原分辨率检测为基准）
+    const double scales[] = {1.0, 0.5, 0.25};
+    std::cout << "\n=== 检测缩放比例 (单会话逐帧分析) ===" << std::endl;
+    std::cout << std::left << std::setw(12) << "分辨率" << std::setw(10) << "缩放"
+              << std::setw(14) << "帧/秒" << std::setw(10) << "加速比" << "召回率" << std::endl;
+
+    for (const auto& resolution : resolutions) {
+        std::vector<cv::Mat> frames = video_path.empty()
+            ? make_synthetic_frames(resolution.width, resolution.height, batch_size)
+            : load_recorded_frames(video_path, resolution.width, resolution.height, batch_size);
+        if (frames.empty()) break;
+
+        FfSessionParams params = default_session_params();
+        std::vector<std::vector<FfFaceResult>> reference, boxes;
+        double baseline = 0.0;
+        for (double scale : scales) {
+            params.detection_scale = scale;
+            double fps = measure_session_fps(frames, params, scale == 1.0 ? reference : boxes);
+            if (baseline == 0.0) baseline = fps;
+            double recall = scale == 1.0 ? 1.0 : compute_recall(reference, boxes);
+
+            std::string label = std::to_string(resolution.width) + "x" + std::to_string(resolution.height);
+            std::cout << std::left << std::setw(12) << label << std::setw(10) << std::setprecision(2) << scale
+                      << std::setw(14) << std::fixed << std::setprecision(1) << fps
+                      << std::setw(10) << std::setprecision(2) << (baseline > 0.0 ? fps / baseline : 0.0)
+                      << std::setprecision(1) << recall * 100.0 << "%" << std::endl;
+            std::cout.unsetf(std::ios::fixed);
+        }
+    }
+
+    // 各检测后端的单帧延迟/召回率（以Haar检测结果为基准）
+    struct BackendCase { int backend; const char* name; };
+    const BackendCase backends[] = {{FF_DETECTOR_HAAR, "Haar"}, {FF_DETECTOR_LBP, "LBP"}, {FF_DETECTOR_YUNET, "YuNet"}};
+    std::cout << "\n=== 检测后端 (单会话逐帧分析) ===" << std::endl;
+    std::cout << std::left << std::setw(12) << "分辨率" << std::setw(10) << "后端"
+              << std::setw(14) << "延迟(ms)" << std::setw(10) << "帧/秒" << "召回率" << std::endl;
+
+    for (const auto& resolution : resolutions) {
+        std::vector<cv::Mat> frames = video_path.empty()
+            ? make_synthetic_frames(resolution.width, resolution.height, batch_size)
+            : load_recorded_frames(video_path, resolution.width, resolution.height, batch_size);
+        if (frames.empty()) break;
+
+        std::string label = std::to_string(resolution.width) + "x" + std::to_string(resolution.height);
+        FfSessionParams params = default_session_params();
+        std::vector<std::vector<FfFaceResult>> reference, boxes;
+        for (const auto& backend : backends) {
+            FfInitOptions options = {backend.backend, nullptr, 0, 0, nullptr, 0};
+            sdk_release();
+            int backend_result = sdk_init_ex(LICENSE_KEY, &options);
+            if (backend_result != 0) {
+                std::cout << std::left << std::setw(12) << label << std::setw(10) << backend.name
+                          << "初始化失败，错误代码: " << backend_result << std::endl;
+                continue;
+            }
+
+            bool is_reference = backend.backend == FF_DETECTOR_HAAR;
+            double fps = measure_session_fps(frames, params, is_reference ? reference : boxes);
+            double recall = is_reference ? 1.0 : compute_recall(reference, boxes);
+            std::cout << std::left << std::setw(12) << label << std::setw(10) << backend.name
+                      << std::setw(14) << std::fixed << std::setprecision(2) << (fps > 0.0 ? 1000.0 / fps : 0.0)
+                      << std::setw(10) << std::setprecision(1) << fps
+                      << recall * 100.0 << "%" << std::endl;
+            std::cout.unsetf(std::ios::fixed);
+        }
+    }
+
+    // 各运动估计方法的速度/误差（以原分辨率稠密光流为基准，误差不超过 MOTION_ERROR_TOLERANCE 为容差内）
+    sdk_release();
+    sdk_init(LICENSE_KEY);
+    struct EstimatorCase { int estimator; const char* name; };
+    const EstimatorCase estimators[] = {{FF_MOTION_FARNEBACK_FULL, "Farneback"},
+                                        {FF_MOTION_FARNEBACK_DOWNSCALED, "Farneback/4"},
+                                        {FF_MOTION_SPARSE_LK, "SparseLK"},
+                                        {FF_MOTION_PHASE_CORRELATION, "PhaseCorr"}};
+    std::cout << "\n=== 运动估计方法 (单会话逐帧分析) ===" << std::endl;
+    std::cout << std::left << std::setw(12) << "分辨率" << std::setw(14) << "方法"
+              << std::setw(14) << "帧/秒" << std::setw(20) << "平均误差(像素/帧)" << "容差内" << std::endl;
+
+    for (const auto& resolution : resolutions) {
+        std::vector<cv::Mat> frames = video_path.empty()
+            ? make_synthetic_frames(resolution.width, resolution.height, batch_size)
+            : load_recorded_frames(video_path, resolution.width, resolution.height, batch_size);
+        if (frames.empty()) break;
+
+        std::string label = std::to_string(resolution.width) + "x" + std::to_string(resolution.height);
+        FfSessionParams params = default_session_params();
+        std::vector<std::vector<FfFaceResult>> reference, results;
+        for (const auto& estimator : estimators) {
+            params.motion_estimator = estimator.estimator;
+            bool is_reference = estimator.estimator == FF_MOTION_FARNEBACK_FULL;
+            double fps = measure_session_fps(frames, params, is_reference ? reference : results);
+            double error = is_reference ? 0.0 : compute_motion_error(reference, results);
+            std::cout << std::left << std::setw(12) << label << std::setw(14) << estimator.name
+                      << std::setw(14) << std::fixed << std::setprecision(1) << fps
+                      << std::setw(20) << std::setprecision(3) << error
+                      << (error <= FastFaceConfig::MOTION_ERROR_TOLERANCE ? "是" : "否") << std::endl;
+            std::cout.unsetf(std::ios::fixed);
+        }
+    }
+
+    // 低照度增强：压暗后的帧在关闭/自动增强下的速度和召回率（以原亮度帧的检测结果为基准）
+    struct LowLightCase { int mode; const char* name; };
+    const LowLightCase low_light_modes[] = {{FF_LOW_LIGHT_OFF, "关闭"}, {FF_LOW_LIGHT_AUTO, "自动"}};
+    std::cout << "\n=== 低照度增强 (亮度压暗至15%) ===" << std::endl;
+    std::cout << std::left << std::setw(12) << "分辨率" << std::setw(10) << "模式"
+              << std::setw(14) << "帧/秒" << "召回率" << std::endl;
+
+    for (const auto& resolution : resolutions) {
+        std::vector<cv::Mat> frames = video_path.empty()
+            ? make_synthetic_frames(resolution.width, resolution.height, batch_size)
+            : load_recorded_frames(video_path, resolution.width, resolution.height, batch_size);
+        if (frames.empty()) break;
+        std::vector<cv::Mat> dark_frames(frames.size());
+        for (size_t i = 0; i < frames.size(); ++i) frames[i].convertTo(dark_frames[i], -1, 0.15);
+
+        std::string label = std::to_string(resolution.width) + "x" + std::to_string(resolution.height);
+        FfSessionParams params = default_session_params();
+        std::vector<std::vector<FfFaceResult>> reference, results;
+        measure_session_fps(frames, params, reference);
+        for (const auto& mode : low_light_modes) {
+            params.low_light_mode = mode.mode;
+            double fps = measure_session_fps(dark_frames, params, results);
+            std::cout << std::left << std::setw(12) << label << std::setw(10) << mode.name
+                      << std::setw(14) << std::fixed << std::setprecision(1) << fps
+                      << compute_recall(reference, results) * 100.0 << "%" << std::endl;
+            std::cout.unsetf(std::ios::fixed);
+        }
+    }
+
+    sdk_release();
+    std::cout << "\n性能测试完成" << std::endl;
+    return 0;
+}
@@ -3,6 +3,8 @@
 #include <iostream>
 #include <string>
 #include <chrono>
+#include <vector>
+#include <nlohmann/json.hpp>
 
 // 解析JSON结果的辅助函数
 void print_analysis_results(const std::string& json_str) {
@@ -70,6 +72,32 @@ void print_analysis_results(const std::string& json_str) {
     }
 }
 
+// 显示结构体形式的分析结果
+void print_face_results(const FfFaceResult* faces, int face_count) {
+    std::cout << "\n=== 人脸分析结果 ===" << std::endl;
+    std::cout << "检测到 " << face_count << " 个人脸" << std::endl;
+    
+    for (int i = 0; i < face_count; ++i) {
+        const FfFaceResult& face = faces[i];
+        std::cout << "\n人脸 " << (i + 1) << ":" << std::endl;
+        std::cout << "  位置: (" << face.bbox.x << ", " << face.bbox.y
+                 << ") 大小: " << face.bbox.width << "x" << face.bbox.height << std::endl;
+        std::cout << "  头部姿态: Yaw=" << face.yaw << "°, Pitch=" << face.pitch
+                 << "°, Roll=" << face.roll << "°" << std::endl;
+        std::cout << "  清晰度: " << face.sharpness << std::endl;
+        std::cout << "  亮度: " << face.brightness << std::endl;
+        std::cout << "  距离: " << face.distance << "cm" << std::endl;
+        std::cout << "  戴口罩: " << (face.has_mask ? "是" : "否") << std::endl;
+        std::cout << "  质量评分:" << std::endl;
+        std::cout << "    清晰度评分: " << face.sharpness_score << "/100" << std::endl;
+        std::cout << "    亮度评分: " << face.brightness_score << "/100" << std::endl;
+        std::cout << "    对比度评分: " << face.contrast_score << "/100" << std::endl;
+        std::cout << "  稳定性: " << (face.is_stable ? "稳定" : "不稳定") << std::endl;
+        std::cout << "  运动模糊: " << face.motion_blur << std::endl;
+    }
+    std::cout << "===================" << std::endl;
+}
+
 // 显示许可证信息
 void print_license_info() {
     char license_info[1024];
@@ -156,6 +184,7 @@ int main() {
     std::cout << "按 'l' 显示许可证信息" << std::endl;
     
     cv::Mat frame;
+    std::vector<char> async_json(FastFaceConfig::ASYNC_RESULT_BUFFER_SIZE);
     int frame_count = 0;
     auto last_analysis_time = std::chrono::steady_clock::now();
     
@@ -169,31 +198,46 @@ int main() {
         // 显示原始帧
         cv::imshow("FastFaceSDK Demo", frame);
         
-        // 每30帧自动分析一次（约1秒）
+        // 每秒自动提交一帧进行异步分析，不阻塞采集循环
         auto current_time = std::chrono::steady_clock::now();
         auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(current_time - last_analysis_time);
         
         if (elapsed.count() > 1000) { // 1秒
-            // 分析当前帧
-            char result_json[4096];
-            int analysis_result = analyze_frame(frame.data, frame.cols, frame.rows, result_json, sizeof(result_json));
+            FfFrameDesc desc = {frame.data, frame.cols, frame.rows, 0, nullptr};
+            int submit_result = ff_submit_frame(&desc, nullptr, nullptr, nullptr);
+            if (submit_result != 0 && submit_result != FastFaceError::QUEUE_FULL) {
+                std::cout << "提交分析失败，错误代码: " << submit_result << std::endl;
+            }
+            last_analysis_time = current_time;
+        }
+        
+        // 取出已完成的分析结果，缓冲区不足时按所需长度扩大后重取，否则结果一直占用未完成帧的名额
+        int frame_status = 0;
+        for (;;) {
+            int poll_result = ff_poll_completion(nullptr, nullptr, &frame_status, async_json.data(),
+                                                 (int)async_json.size(), 0);
+            if (poll_result == FastFaceError::BUFFER_TOO_SMALL) {
+                int required = 0;
+                if (ff_peek_completion_size(&required) != 0) break;
+                async_json.resize(required);
+                continue;
+            }
+            if (poll_result != 0) break;
             
-            if (analysis_result == 0) {
-                print_analysis_results(result_json);
+            if (frame_status == 0) {
+                print_analysis_results(async_json.data());
             } else {
-                std::cout << "分析失败，错误代码: " << analysis_result << std::endl;
+                std::cout << "分析失败，错误代码: " << frame_status << std::endl;
                 
                 // 检查是否是许可证相关错误
-                if (analysis_result == -1) {
+                if (frame_status == -1) {
                     std::cout << "许可证密钥无效" << std::endl;
-                } else if (analysis_result == -2) {
+                } else if (frame_status == -2) {
                     std::cout << "许可证密钥已过期" << std::endl;
-                } else if (analysis_result == -3) {
+                } else if (frame_status == -3) {
                     std::cout << "试用期已过期" << std::endl;
                 }
             }
-            
-            last_analysis_time = current_time;
         }
         
         frame_count++;
@@ -208,12 +252,14 @@ int main() {
             cv::imwrite(filename, frame);
             std::cout << "帧已保存为: " << filename << std::endl;
         } else if (key == 'a') {
-            // 手动分析当前帧
-            char result_json[4096];
-            int analysis_result = analyze_frame(frame.data, frame.cols, frame.rows, result_json, sizeof(result_json));
+            // 手动分析当前帧，直接获取结构体结果
+            FfFaceResult faces[FastFaceConfig::MAX_FACES_PER_FRAME];
+            int face_count = 0;
+            int analysis_result = analyze_frame_ex(frame.data, frame.cols, frame.rows,
+                                                   faces, FastFaceConfig::MAX_FACES_PER_FRAME, &face_count);
             
             if (analysis_result == 0) {
-                print_analysis_results(result_json);
+                print_face_results(faces, face_count);
             } else {
                 std::cout << "分析失败，错误代码: " << analysis_result << std::endl;
             }
@@ -23,6 +23,31 @@ namespace FastFaceConfig {
     constexpr double FACE_DETECTION_SCALE_FACTOR = 1.1;
     constexpr int FACE_DETECTION_MIN_NEIGHBORS = 3;
     constexpr int FACE_DETECTION_MIN_SIZE = 50;
+    constexpr int DETECTOR_BACKEND = 0;            // 人脸检测后端，见 FfDetectorBackend
+    constexpr double DETECTION_SCALE = 1.0;        // 检测图像相对原图的缩放比例，1表示原分辨率检测
+    constexpr int DETECTION_WIDTH = 0;             // 检测图像目标宽度，>0时优先于 DETECTION_SCALE
+    
+    // CNN人脸检测参数（YuNet，cv::dnn CPU后端）
+    constexpr const char* YUNET_MODEL_FILE = "face_detection_yunet_2023mar.onnx";  // 位于SDK模型目录（构建时的 FAST_FACE_MODEL_DIR）
+    constexpr int YUNET_INPUT_WIDTH = 320;         // 网络最大输入尺寸，检测图像等比缩小到不超过该尺寸
+    constexpr int YUNET_INPUT_HEIGHT = 240;
+    constexpr double YUNET_SCORE_THRESHOLD = 0.6;
+    constexpr double YUNET_NMS_THRESHOLD = 0.3;
+    constexpr int YUNET_TOP_K = 50;
+    
+    // LBP级联快速模式参数（整数特征，适合低端CPU）
+    constexpr const char* LBP_CASCADE_FILE = "lbpcascade_frontalface_improved.xml";  // 依次在SDK模型目录和OpenCV数据目录的 lbpcascades 中查找
+    constexpr double LBP_SCALE_FACTOR = 1.2;
+    constexpr int LBP_MIN_NEIGHBORS = 4;
+    
+    // 检测-跟踪参数
+    constexpr int DETECTION_INTERVAL = 1;          // 每隔多少帧做一次完整检测，1表示每帧检测
+    constexpr double MIN_TRACK_CONFIDENCE = 0.5;   // 跟踪置信度低于该值时立即重新检测
+    constexpr int TRACK_MAX_POINTS = 30;           // 每个人脸跟踪的特征点数
+    constexpr int TRACK_MIN_POINTS = 4;            // 少于该点数视为跟踪失败
+    constexpr int FULL_SCAN_PERIOD = 1;            // 每隔多少次检测做一次全画面检测，其余只在已知人脸附近检测
+    constexpr double ROI_EXPAND_FACTOR = 2.0;      // 局部检测窗口相对人脸框的放大倍数
+    constexpr double FLAT_WINDOW_STDDEV = 2.0;     // 亮度标准差低于该值的局部窗口视为纯色区域，跳过检测
     
     // 稳定性检测参数
     constexpr int STABLE_FRAMES_THRESHOLD = 3;
@@ -35,6 +60,21 @@ namespace FastFaceConfig {
     constexpr double BRIGHTNESS_MAX = 220.0;
     constexpr double BRIGHTNESS_OPTIMAL = 127.5;
     
+    // 低照度增强参数（检测前作用于亮度平面）
+    constexpr int LOW_LIGHT_MODE = 1;              // 见 FfLowLightMode，默认按帧平均亮度自动启用
+    constexpr double LOW_LIGHT_CLAHE_CLIP = 3.0;   // CLAHE对比度限制
+    constexpr int LOW_LIGHT_CLAHE_TILES = 8;       // CLAHE网格数（每个方向）
+    constexpr double LOW_LIGHT_GAMMA = 1.5;        // gamma校正系数，输出 = 255 * (输入/255)^(1/gamma)
+    
+    // 默认启用的分析阶段：FF_STAGE_ALL（本文件先于 FfStage 定义，取值由 fast_face_sdk.cpp 中的 static_assert 核对）
+    constexpr int DEFAULT_STAGES = (1 << 6) - 1;
+    
+    // 质量门限（默认不检查），未达标的人脸跳过 GATED_STAGES 中的阶段
+    constexpr int GATE_MIN_FACE_SIZE = 0;          // 人脸框短边最小像素数
+    constexpr double GATE_MIN_BRIGHTNESS_SCORE = 0.0;
+    constexpr double GATE_MIN_SHARPNESS_SCORE = 0.0;
+    constexpr int GATED_STAGES = (1 << 0) | (1 << 1) | (1 << 2);  // FF_STAGE_LANDMARKS | FF_STAGE_POSE | FF_STAGE_MASK
+    
     // 距离估计参数
     constexpr double AVG_PUPIL_DISTANCE_MM = 63.0;
     constexpr double DEFAULT_DISTANCE_CM = 50.0;
@@ -42,6 +82,19 @@ namespace FastFaceConfig {
     // 口罩检测参数
     constexpr double BLUE_MASK_RATIO_THRESHOLD = 0.1;
     constexpr double WHITE_MASK_RATIO_THRESHOLD = 0.3;
+    constexpr int BLUE_MASK_H_MIN = 100;           // 蓝色口罩HSV范围（OpenCV 8位HSV，H为0-180）
+    constexpr int BLUE_MASK_H_MAX = 130;
+    constexpr int BLUE_MASK_S_MIN = 50;
+    constexpr int BLUE_MASK_V_MIN = 50;
+    constexpr int WHITE_MASK_S_MAX = 30;           // 白色口罩HSV范围
+    constexpr int WHITE_MASK_V_MIN = 200;
+    
+    // 口罩分类网络参数（cv::dnn CPU后端，未配置模型时使用上面的颜色启发式）
+    constexpr const char* MASK_MODEL_PATH = "";    // 默认不加载模型
+    constexpr int MASK_MODEL_INPUT_SIZE = 128;     // 网络输入边长，人脸区域缩放到该尺寸
+    constexpr double MASK_MODEL_THRESHOLD = 0.5;   // 戴口罩概率阈值
+    constexpr int MASK_MODEL_MASK_CLASS = 0;       // 输出中"戴口罩"类别的下标，单列输出时直接视为概率
+    constexpr int MASK_INTERVAL = 1;               // 同一跟踪人脸每隔多少帧重新分类，1表示每帧分类
     
     // 头部姿态参数
     constexpr double POSE_WARNING_THRESHOLD = 30.0;
@@ -51,9 +104,40 @@ namespace FastFaceConfig {
     constexpr int MAX_IMAGE_HEIGHT = 1080;
     constexpr int MAX_FACES_PER_FRAME = 10;
     constexpr int MAX_JSON_BUFFER_SIZE = 4096;
+    constexpr int JSON_FLOAT_PRECISION = 3;    // JSON输出的小数位数
+    constexpr int WORKER_THREADS = 0;          // 批量分析工作线程数，0表示使用CPU核心数
+    constexpr int MAX_IN_FLIGHT_FRAMES = 8;    // 异步分析最多同时未完成的帧数
+    constexpr int ASYNC_RESULT_BUFFER_SIZE = 16384;   // ff_poll_completion 建议的结果缓冲区大小（SDK内部按实际长度格式化）
+    
+    // 运动估计参数
+    constexpr int MOTION_ESTIMATOR = 1;            // 默认运动估计方法，见 FfMotionEstimator（缩小后的稠密光流）
+    constexpr double MOTION_ERROR_TOLERANCE = 2.0; // 相对原分辨率稠密光流的允许误差（像素/帧），默认方法取容差内最快的一种
+    constexpr double MOTION_DOWNSCALE = 0.25;      // 缩小版稠密光流的缩放比例
+    constexpr double MOTION_ROI_MARGIN = 0.25;     // 稠密光流区域在人脸框四周外扩的比例（相对人脸宽高）
+    constexpr int MOTION_GRID_POINTS = 5;          // 稀疏光流在人脸区域内每边取的网格点数
+    
+    // 关键点跟踪参数
+    constexpr int LANDMARK_TRACKING = 0;           // 是否默认启用关键点跟踪（0/1）
+    constexpr int LANDMARK_REFIT_INTERVAL = 10;    // 连续跟踪的最大帧数，之后强制重新拟合
+    constexpr double LANDMARK_MAX_TRACK_ERROR = 12.0;  // 光流平均误差上限，超过时重新拟合
+    constexpr double LANDMARK_MAX_DRIFT = 0.15;    // 关键点中心偏离人脸框中心的上限（相对人脸宽度）
     
     // 历史记录参数
-    constexpr int FACE_HISTORY_SIZE = 5;
+    constexpr int FACE_HISTORY_SIZE = 5;           // 每条人脸轨迹保留的历史帧数
+    
+    // 多人脸轨迹关联参数
+    constexpr double TRACK_MATCH_IOU = 0.3;        // 人脸框与轨迹的IoU不低于该值时可关联
+    constexpr double TRACK_MATCH_DISTANCE = 0.5;   // 或中心距离（相对轨迹人脸宽度）不超过该值时可关联
+    constexpr int TRACK_MAX_MISSES = 5;            // 轨迹连续未关联超过该帧数后删除
+    
+    // 最佳抓拍参数
+    constexpr int BEST_SHOT_COUNT = 0;             // 每条轨迹保留的最佳帧数，0表示关闭
+    constexpr int BEST_SHOT_POOL_SIZE = 32;        // 每个会话缓存的人脸图像数上限
+    constexpr double BEST_SHOT_WEIGHT_SHARPNESS = 0.4;   // 综合评分中各项评分的权重
+    constexpr double BEST_SHOT_WEIGHT_BRIGHTNESS = 0.2;
+    constexpr double BEST_SHOT_WEIGHT_CONTRAST = 0.2;
+    constexpr double BEST_SHOT_WEIGHT_POSE = 0.2;  // 姿态评分随 max(|yaw|, |pitch|) 线性下降，达到 POSE_WARNING_THRESHOLD 时为0；
+                                                   // 未执行姿态阶段时不计入，其余权重重新归一化
 }
 
 // 错误代码定义
@@ -69,4 +153,8 @@ namespace FastFaceError {
     constexpr int NOT_INITIALIZED = -100;
     constexpr int INVALID_PARAMETERS = -8;
     constexpr int BUFFER_TOO_SMALL = -9;
+    constexpr int QUEUE_FULL = -10;
+    constexpr int NO_RESULT = -11;
+    constexpr int MASK_MODEL_LOAD_FAILED = -12;
+    constexpr int CALLED_FROM_WORKER = -13;     // 在SDK工作线程（回调）中调用了不允许的函数
 } 
\ No newline at end of file
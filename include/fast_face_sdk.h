@@ -47,11 +47,53 @@ extern "C" {
      * - -4: 人脸检测模型加载失败
      * - -5: 眼睛检测模型加载失败
      * - -6: 初始化异常
+     * - -13: 在SDK工作线程（完成回调等）中调用
+     * 
+     * 重新初始化会替换默认会话和视频流会话，不能在SDK工作线程上调用。
      */
     FAST_FACE_API int sdk_init(const char* license_key);
 
+    /**
+     * @brief 人脸检测后端
+     */
+    enum FfDetectorBackend {
+        FF_DETECTOR_HAAR = 0,   // Haar级联（haarcascade_frontalface_alt2）
+        FF_DETECTOR_YUNET = 1,  // YuNet CNN检测器（ONNX模型，cv::dnn CPU后端）
+        FF_DETECTOR_LBP = 2     // LBP级联快速模式（整数特征，适合ARM及低端CPU）
+    };
+
+    /**
+     * @brief 初始化选项
+     * 
+     * 字段为0或空时使用 fast_face_config.h 中的默认值。
+     */
+    typedef struct FfInitOptions {
+        int detector_backend;               // 人脸检测后端，见 FfDetectorBackend
+        const char* detector_model_path;    // CNN检测器模型或LBP级联文件路径，为空时从SDK模型目录加载（LBP级联还会查找OpenCV数据目录）
+        int detector_input_width;           // CNN检测器最大输入宽度
+        int detector_input_height;          // CNN检测器最大输入高度
+        const char* mask_model_path;        // 口罩分类网络模型路径，为空时使用颜色启发式
+        int stages;                         // 可用的分析阶段，见 FfStage，0表示全部；未包含关键点和姿态时不加载关键点模型
+    } FfInitOptions;
+
+    /**
+     * @brief 使用指定选项初始化SDK
+     * @param license_key 许可证密钥
+     * @param options 初始化选项，为空时等价于 sdk_init
+     * @return 0表示成功，非0表示失败，错误代码同 sdk_init（-8表示选项无效，-12表示口罩模型加载失败，-13表示在工作线程上调用）
+     * 
+     * 检测后端对之后创建的所有会话生效。CNN检测器的检测图像（整帧或局部窗口）按原宽高比
+     * 缩小到不超过输入尺寸后送入网络，网络输入尺寸只在图像尺寸变化时重新设置。
+     * 
+     * 配置口罩分类模型后，每帧所有待分类的人脸区域合并为一个批次做一次前向计算；
+     * 网络输入为 RGB、归一化到[0,1]的 MASK_MODEL_INPUT_SIZE 方形图像。
+     */
+    FAST_FACE_API int sdk_init_ex(const char* license_key, const FfInitOptions* options);
+
     /**
      * @brief 分析一帧BGR图像
+     * 
+     * 使用 sdk_init 创建的默认会话，等价于在默认会话上调用 ff_session_analyze。
      * @param bgr_data BGR格式的图像数据
      * @param width 图像宽度
      * @param height 图像高度
@@ -62,9 +104,13 @@ extern "C" {
      * 错误代码:
      * - -100: SDK未初始化
      * - -8: 参数错误
-     * - -9: 缓冲区太小
+     * - -9: 缓冲区太小（可调用 get_last_result_json 查询所需长度并重新获取，无需重新分析）
      * - -7: 分析过程异常
      * 
+     * 浮点数以固定小数位数（FastFaceConfig::JSON_FLOAT_PRECISION）输出。
+     * 人脸未通过会话的质量门限时额外输出 "skipped_stages"（如 ["landmarks", "pose"]），对应字段为0。
+     * 会话未启用的分析阶段（见 FfStage）对应的字段不输出。
+     * 
      * 返回的JSON格式:
      * {
      *   "code": 0,
@@ -77,6 +123,8 @@ extern "C" {
      *   "faces": [
      *     {
      *       "bbox": {"x": 100, "y": 50, "width": 200, "height": 250},
+     *       "track_id": 1,
+     *       "source": "detected",
      *       "pose": {"yaw": 5.2, "pitch": -2.1, "roll": 1.5},
      *       "metrics": {"sharpness": 45.6, "brightness": 128.3, "has_mask": false, "distance": 50.0},
      *       "quality_scores": {"sharpness_score": 85.2, "brightness_score": 92.1, "contrast_score": 78.5},
@@ -87,10 +135,485 @@ extern "C" {
      */
     FAST_FACE_API int analyze_frame(const unsigned char* bgr_data, int width, int height, char* result_json, int json_buf_len);
 
+    /**
+     * @brief 输入图像的像素格式
+     */
+    enum FfPixelFormat {
+        FF_PIXEL_BGR = 0,   // 交错BGR，1个平面
+        FF_PIXEL_GRAY = 1,  // 8位灰度，1个平面
+        FF_PIXEL_NV12 = 2,  // Y平面 + 交错UV平面（4:2:0）
+        FF_PIXEL_NV21 = 3,  // Y平面 + 交错VU平面（4:2:0）
+        FF_PIXEL_I420 = 4,  // Y、U、V三个平面（4:2:0）
+        FF_PIXEL_YUYV = 5   // 交错YUYV（4:2:2），1个平面
+    };
+
+    /**
+     * @brief 输入图像描述
+     * 
+     * 支持任意行跨度，可直接传入大缓冲区中的子区域而无需重新打包。
+     * 灰度和YUV格式的亮度平面直接用于检测和运动分析，不做拷贝；
+     * 只有需要颜色信息的人脸区域（口罩检测）才会转换为BGR。
+     * 
+     * - planes[i] 为空时，该平面紧跟在前一个平面之后（常见的连续缓冲区布局）
+     * - strides[i] 为0时使用默认行跨度：首个平面为紧密排列，
+     *   NV12/NV21的UV平面与Y平面相同，I420的U/V平面为Y平面的一半
+     * - YUV格式要求宽高为偶数
+     */
+    typedef struct FfImage {
+        int format;                     // 像素格式，见 FfPixelFormat
+        int width;                      // 图像宽度
+        int height;                     // 图像高度
+        const unsigned char* planes[3]; // 各平面起始地址
+        int strides[3];                 // 各平面行跨度（字节）
+    } FfImage;
+
+    /**
+     * @brief 矩形区域
+     */
+    typedef struct FfRect {
+        int x;
+        int y;
+        int width;
+        int height;
+    } FfRect;
+
+    /**
+     * @brief 单个人脸的分析结果，字段含义与JSON结果一一对应
+     */
+    typedef struct FfFaceResult {
+        FfRect bbox;                    // 人脸边界框
+        
+        // 头部姿态（度）
+        double yaw;
+        double pitch;
+        double roll;
+        
+        // 图像指标
+        double sharpness;
+        double brightness;
+        double distance;                // 估计距离（厘米）
+        int has_mask;                   // 是否佩戴口罩（0/1）
+        
+        // 质量评分（0-100）
+        double sharpness_score;
+        double brightness_score;
+        double contrast_score;
+        
+        // 稳定性
+        int is_stable;                  // 是否稳定（0/1）
+        double motion_blur;             // 人脸区域的平均运动幅度（像素/帧）
+        
+        int is_tracked;                 // 0: 本帧检测得到，1: 由上一帧跟踪得到
+        int track_id;                   // 人脸轨迹ID，同一会话内同一人跨帧保持不变（从1开始，不复用）
+        int skipped_stages;             // 未通过质量门限而跳过的分析阶段，见 FfStage；跳过的字段为0
+        int stages;                     // 会话启用的分析阶段，见 FfStage；未启用阶段的字段为0，JSON中省略
+    } FfFaceResult;
+
+    /**
+     * @brief 分析会话句柄
+     * 
+     * 每个会话独立持有人脸检测器、稳定性历史和上一帧灰度图等时序状态，
+     * 不同会话可以在不同线程上并行分析；同一会话上的调用会被串行化。
+     * 建议每路摄像头使用一个会话。
+     */
+    typedef struct FfSession FfSession;
+
+    /**
+     * @brief 创建分析会话
+     * @param out_session 输出会话句柄
+     * @return 0表示成功，非0表示失败
+     * 
+     * 错误代码:
+     * - -100: SDK未初始化
+     * - -8: 参数错误
+     * - -4: 人脸检测模型加载失败
+     * - -6: 创建异常
+     */
+    FAST_FACE_API int ff_session_create(FfSession** out_session);
+
+    /**
+     * @brief 在指定会话上分析一帧BGR图像
+     * @param session 会话句柄
+     * @param bgr_data BGR格式的图像数据
+     * @param width 图像宽度
+     * @param height 图像高度
+     * @param result_json 输出JSON结果的缓冲区
+     * @param json_buf_len 缓冲区长度
+     * @return 0表示成功，非0表示失败，错误代码与JSON格式同 analyze_frame
+     */
+    FAST_FACE_API int ff_session_analyze(FfSession* session, const unsigned char* bgr_data, int width, int height, char* result_json, int json_buf_len);
+
+    /**
+     * @brief 在指定会话上分析一帧任意格式的图像
+     * @param session 会话句柄
+     * @param image 输入图像描述
+     * @param result_json 输出JSON结果的缓冲区
+     * @param json_buf_len 缓冲区长度
+     * @return 0表示成功，非0表示失败，错误代码与JSON格式同 analyze_frame
+     */
+    FAST_FACE_API int ff_session_analyze_image(FfSession* session, const FfImage* image, char* result_json, int json_buf_len);
+
+    /**
+     * @brief 在指定会话上分析一帧图像，输出结构体结果
+     * @param session 会话句柄
+     * @param image 输入图像描述
+     * @param faces 调用方提供的结果数组
+     * @param max_faces 结果数组容量
+     * @param face_count 输出检测到的人脸总数
+     * @return 0表示成功，非0表示失败
+     * 
+     * 不构建JSON，热路径上不分配结果内存。人脸数超过 max_faces 时写入前
+     * max_faces 个结果，face_count 仍为总数，并返回 -9。
+     */
+    FAST_FACE_API int ff_session_analyze_ex(FfSession* session, const FfImage* image,
+                                            FfFaceResult* faces, int max_faces, int* face_count);
+
+    /**
+     * @brief 重新获取会话最近一帧的JSON结果
+     * @param session 会话句柄
+     * @param result_json 输出JSON结果的缓冲区，可为空（此时 json_buf_len 须为0）
+     * @param json_buf_len 缓冲区长度
+     * @param required_size 输出所需的缓冲区长度（含结尾'\0'），可为空
+     * @return 0表示成功，-9表示缓冲区太小，其他非0值表示失败
+     * 
+     * 只重新格式化已缓存的结果，不重新分析。
+     */
+    FAST_FACE_API int ff_session_get_result_json(FfSession* session, char* result_json, int json_buf_len, int* required_size);
+
+    /**
+     * @brief 运动估计方法
+     * 
+     * 各方法均只计算人脸区域（稠密光流为人脸框四周外扩 MOTION_ROI_MARGIN 的区域），
+     * 输出每个人脸框内的平均运动幅度（原分辨率像素/帧）。
+     * 默认使用误差在 MOTION_ERROR_TOLERANCE 以内的方法中最快的一种。
+     */
+    enum FfMotionEstimator {
+        FF_MOTION_FARNEBACK_FULL = 0,       // 原分辨率稠密光流（误差基准，最慢）
+        FF_MOTION_FARNEBACK_DOWNSCALED = 1, // 按 MOTION_DOWNSCALE 缩小后的稠密光流（默认）
+        FF_MOTION_SPARSE_LK = 2,            // 人脸区域网格点上的稀疏光流
+        FF_MOTION_PHASE_CORRELATION = 3     // 人脸区域相位相关（只估计整体平移）
+    };
+
+    /**
+     * @brief 单个人脸的分析阶段（位掩码）
+     * 
+     * 人脸检测和轨迹关联总是执行。未启用的阶段不产生任何逐帧开销，对应字段在JSON中省略。
+     */
+    enum FfStage {
+        FF_STAGE_LANDMARKS = 1 << 0,        // 关键点拟合/跟踪
+        FF_STAGE_POSE = 1 << 1,             // 头部姿态估计（依赖关键点，启用时关键点一并启用）
+        FF_STAGE_MASK = 1 << 2,             // 口罩检测
+        FF_STAGE_QUALITY = 1 << 3,          // 清晰度、亮度、对比度及其评分
+        FF_STAGE_MOTION = 1 << 4,           // 人脸区域运动幅度（motion_blur）
+        FF_STAGE_STABILITY = 1 << 5,        // 稳定性判断
+        FF_STAGE_ALL = (1 << 6) - 1
+    };
+
+    /**
+     * @brief 低照度增强模式
+     * 
+     * 增强只作用于送入检测器的亮度平面（CLAHE + gamma查找表），跟踪和质量评分仍使用原始图像。
+     */
+    enum FfLowLightMode {
+        FF_LOW_LIGHT_OFF = 0,               // 不增强
+        FF_LOW_LIGHT_AUTO = 1,              // 帧平均亮度低于 BRIGHTNESS_MIN 时增强（默认）
+        FF_LOW_LIGHT_ALWAYS = 2             // 每次检测前都增强
+    };
+
+    /**
+     * @brief 会话参数
+     * 
+     * 检测-跟踪模式：每 detection_interval 帧做一次完整人脸检测，其余帧用稀疏光流
+     * 跟踪上一帧的人脸框；任一人脸的跟踪置信度低于 min_track_confidence 时立即重新检测。
+     * 结果中的 source 字段（结构体为 is_tracked）标明人脸框的来源。
+     * 
+     * 检测缩放：人脸检测在按 detection_scale（或 detection_width）缩小的灰度图上进行，
+     * 人脸框映射回原分辨率，各项人脸指标仍在原分辨率像素上计算。
+     * 
+     * 局部检测：full_scan_period 大于1时，两次全画面检测之间只在上一次人脸位置
+     * 按 roi_expand_factor 放大的窗口内检测；窗口内未找到任何人脸时立即回退到全画面检测。
+     * 
+     * 关键点跟踪：landmark_tracking 为1时，上一帧的68个关键点用金字塔光流传播到当前帧，
+     * 只有跟踪误差或漂移过大、或连续跟踪帧数达到上限时才重新运行完整的LBF拟合。
+     * 
+     * 相机内参：用于头部姿态估计。focal_length_x 为0时使用默认模型
+     * （焦距等于图像宽度，主点为图像中心）。
+     */
+    typedef struct FfSessionParams {
+        int detection_interval;         // 完整检测间隔（帧），1表示每帧检测
+        double min_track_confidence;    // 最低跟踪置信度（0-1）
+        double detection_scale;         // 检测缩放比例（0-1]，1表示原分辨率检测
+        int detection_width;            // 检测图像目标宽度（像素），>0时优先于 detection_scale，不放大
+        int full_scan_period;           // 全画面检测周期（以检测次数计），1表示每次都全画面检测
+        double roi_expand_factor;       // 局部检测窗口相对人脸框的放大倍数，不小于1
+        double focal_length_x;          // 相机焦距（像素），0表示使用默认模型
+        double focal_length_y;          // 为0时与 focal_length_x 相同
+        double principal_x;             // 主点坐标（像素），负数表示图像中心（默认），focal_length_x 为0时忽略
+        double principal_y;
+        int landmark_tracking;          // 1表示启用关键点跟踪，0表示每帧重新拟合
+        int motion_estimator;           // 运动估计方法，见 FfMotionEstimator
+        int mask_interval;              // 口罩分类间隔（帧），同一跟踪人脸在间隔内沿用上次结果，仅模型分类时有效
+        int low_light_mode;             // 低照度增强模式，见 FfLowLightMode
+        
+        // 质量门限：人脸框尺寸、亮度和清晰度依次检查（先做代价低的），任一项不达标时
+        // 跳过 gated_stages 中的阶段；门限为0表示不检查
+        int gate_min_face_size;         // 人脸框短边最小像素数
+        double gate_min_brightness_score;   // 最低亮度评分（0-100）
+        double gate_min_sharpness_score;    // 最低清晰度评分（0-100）
+        int gated_stages;               // 不达标时跳过的阶段，FfStage 的组合；跳过关键点时姿态一并跳过
+        int best_shot_count;            // 每条人脸轨迹保留的最佳帧数（0-BEST_SHOT_POOL_SIZE），0表示关闭最佳抓拍
+        int stages;                     // 启用的分析阶段，见 FfStage，须为 sdk_init_ex 可用阶段的子集
+    } FfSessionParams;
+
+    /**
+     * @brief 获取会话参数
+     * @param session 会话句柄
+     * @param params 输出当前参数
+     * @return 0表示成功，-8表示参数错误
+     */
+    FAST_FACE_API int ff_session_get_params(FfSession* session, FfSessionParams* params);
+
+    /**
+     * @brief 设置会话参数，从下一帧开始生效
+     * @param session 会话句柄
+     * @param params 新参数，建议先用 ff_session_get_params 获取再修改
+     * @return 0表示成功，-8表示参数错误或取值超出范围
+     */
+    FAST_FACE_API int ff_session_set_params(FfSession* session, const FfSessionParams* params);
+
+    /**
+     * @brief 获取会话缓冲区的累计分配次数
+     * @param session 会话句柄
+     * @param count 输出自会话创建以来会话内部缓冲区的（重新）分配次数
+     * @return 0表示成功，-8表示参数错误
+     * 
+     * 会话的临时图像在首帧按帧尺寸分配后逐帧复用，前后两帧的亮度平面交换使用而不复制。
+     * 帧尺寸、像素格式和人脸数不再增加后，该计数应保持不变，可用于确认这些缓冲区稳态下不再分配。
+     * 
+     * 注意：稳态零分配只覆盖会话自有的缓冲区，以下分配每帧仍会发生且不计入该计数：
+     * Farneback稠密光流的内部金字塔、LK光流的内部金字塔和梯度图、CLAHE的内部缓冲区、
+     * 口罩网络前向计算、检测器和LBF拟合的内部缓冲区，以及多人脸并行时的任务状态。
+     */
+    FAST_FACE_API int ff_session_get_alloc_count(FfSession* session, long long* count);
+
+    /**
+     * @brief 最佳抓拍结果
+     */
+    typedef struct FfBestShot {
+        int track_id;                   // 人脸轨迹ID
+        int frame_index;                // 该帧在会话内的序号（从0开始）
+        double score;                   // 综合评分（0-100）
+        FfFaceResult face;              // 该帧的人脸结果
+        int width;                      // 人脸图像尺寸，图像为BGR，行跨度为 width * 3
+        int height;
+    } FfBestShot;
+
+    /**
+     * @brief 取出一张最佳抓拍
+     * @param session 会话句柄
+     * @param shot 输出抓拍信息
+     * @param bgr_buf 输出人脸图像的缓冲区，长度至少为 width * height * 3
+     * @param buf_len 缓冲区长度
+     * @return 0表示取到，-11表示暂无结果，-9表示缓冲区太小（shot 已填写尺寸，结果保留在队列中）
+     * 
+     * session 的 best_shot_count 大于0时，每条人脸轨迹按清晰度、亮度、对比度和姿态的综合评分
+     * 保留最好的若干帧及其人脸图像；未执行姿态阶段的帧不计姿态项，其余各项按权重重新归一化。轨迹结束（人脸连续 TRACK_MAX_MISSES 帧未出现）或调用
+     * ff_session_flush_best_shots 时，这些帧按评分从高到低进入输出队列。
+     * 会话缓存的人脸图像总数不超过 BEST_SHOT_POOL_SIZE；已满时新候选只能替换同一轨迹中评分更低的帧，
+     * 否则被丢弃，队列中未取走的结果和其他轨迹的候选不会被挤掉。
+     */
+    FAST_FACE_API int ff_session_poll_best_shot(FfSession* session, FfBestShot* shot, unsigned char* bgr_buf, int buf_len);
+
+    /**
+     * @brief 立即输出轨迹当前保留的最佳帧
+     * @param session 会话句柄
+     * @param track_id 轨迹ID，0表示所有轨迹
+     * @return 0表示成功，-8表示参数错误
+     * 
+     * 输出后该轨迹重新开始挑选。
+     */
+    FAST_FACE_API int ff_session_flush_best_shots(FfSession* session, int track_id);
+
+    /**
+     * @brief 销毁分析会话
+     * @param session 会话句柄，允许为空
+     * 
+     * 销毁时不得有其他线程正在使用该会话。会话可以在 sdk_release 之后销毁。
+     */
+    FAST_FACE_API void ff_session_destroy(FfSession* session);
+
+    /**
+     * @brief 使用默认会话分析一帧BGR图像，输出结构体结果
+     * @param bgr_data BGR格式的图像数据
+     * @param width 图像宽度
+     * @param height 图像高度
+     * @param faces 调用方提供的结果数组
+     * @param max_faces 结果数组容量，建议为 FastFaceConfig::MAX_FACES_PER_FRAME
+     * @param face_count 输出检测到的人脸总数
+     * @return 0表示成功，非0表示失败，错误代码同 ff_session_analyze_ex
+     */
+    FAST_FACE_API int analyze_frame_ex(const unsigned char* bgr_data, int width, int height,
+                                       FfFaceResult* faces, int max_faces, int* face_count);
+
+    /**
+     * @brief 将结构体结果格式化为JSON
+     * @param faces 结果数组
+     * @param face_count 结果数量
+     * @param result_json 输出JSON结果的缓冲区，可为空（此时 json_buf_len 须为0）
+     * @param json_buf_len 缓冲区长度
+     * @param required_size 输出所需的缓冲区长度（含结尾'\0'），可为空
+     * @return 0表示成功，-9表示缓冲区太小，其他非0值表示失败
+     * 
+     * 输出格式与 analyze_frame 相同，包含当前许可证信息。
+     */
+    FAST_FACE_API int ff_format_result_json(const FfFaceResult* faces, int face_count, char* result_json, int json_buf_len,
+                                            int* required_size);
+
+    /**
+     * @brief 重新获取默认会话最近一帧的JSON结果
+     * @param result_json 输出JSON结果的缓冲区，可为空（此时 json_buf_len 须为0）
+     * @param json_buf_len 缓冲区长度
+     * @param required_size 输出所需的缓冲区长度（含结尾'\0'），可为空
+     * @return 0表示成功，-9表示缓冲区太小，其他非0值表示失败
+     * 
+     * analyze_frame 返回 -9 时分析结果仍被保留，可用本函数查询所需长度并
+     * 以足够大的缓冲区重新获取，无需重新分析该帧。
+     */
+    FAST_FACE_API int get_last_result_json(char* result_json, int json_buf_len, int* required_size);
+
+
+    /**
+     * @brief 使用默认会话分析一帧任意格式的图像
+     * @param image 输入图像描述
+     * @param result_json 输出JSON结果的缓冲区
+     * @param json_buf_len 缓冲区长度
+     * @return 0表示成功，非0表示失败，错误代码与JSON格式同 analyze_frame
+     */
+    FAST_FACE_API int analyze_image(const FfImage* image, char* result_json, int json_buf_len);
+
+    /**
+     * @brief 批量分析的输入帧描述
+     * 
+     * stream_id >= 0 的帧属于对应视频流，同一视频流的帧按数组顺序依次分析，
+     * 并累积该流的稳定性历史和运动模糊状态；stream_id < 0 的帧彼此独立，
+     * 不携带任何时序状态，可完全并行处理（适合离线重处理）。
+     */
+    typedef struct FfFrameDesc {
+        const unsigned char* bgr_data;  // BGR格式的图像数据
+        int width;                      // 图像宽度
+        int height;                     // 图像高度
+        int stream_id;                  // 视频流ID
+        const FfImage* image;           // 非空时使用该图像描述，忽略以上三个字段
+    } FfFrameDesc;
+
+    /**
+     * @brief 批量分析的输出缓冲区
+     */
+    typedef struct FfJsonOutput {
+        char* result_json;              // 输出JSON结果的缓冲区
+        int json_buf_len;               // 缓冲区长度
+        int status;                     // 该帧的返回码，由SDK填写
+        int required_size;              // JSON所需的缓冲区长度（含结尾'\0'），由SDK填写
+    } FfJsonOutput;
+
+    /**
+     * @brief 在内部线程池上批量分析多帧图像
+     * @param frames 输入帧数组
+     * @param frame_count 帧数量
+     * @param outputs 输出缓冲区数组，与frames一一对应
+     * @return 0表示全部成功，否则返回第一个失败帧的错误代码
+     * 
+     * 整批只检查一次许可证。不同视频流的帧分布到不同工作线程上并行分析，
+     * 每帧的返回码写入 outputs[i].status，JSON格式同 analyze_frame。
+     * 视频流的状态在SDK内部保存，直到调用 ff_release_stream 或 sdk_release。
+     */
+    FAST_FACE_API int analyze_frames(const FfFrameDesc* frames, int frame_count, FfJsonOutput* outputs);
+
+    /**
+     * @brief 异步分析完成回调
+     * @param ticket 提交时返回的票据
+     * @param stream_id 视频流ID
+     * @param status 该帧的返回码
+     * @param result_json JSON结果，仅在回调期间有效；失败时为空字符串
+     * @param user_data 提交时传入的用户数据
+     * 
+     * 回调在SDK工作线程上执行，应尽快返回。
+     */
+    typedef void (*FfCompletionCallback)(unsigned long long ticket, int stream_id, int status,
+                                         const char* result_json, void* user_data);
+
+    /**
+     * @brief 异步提交一帧图像
+     * @param frame 输入帧，图像数据在提交时被复制，返回后调用方即可复用缓冲区
+     * @param callback 完成回调；为空时结果进入完成队列，由 ff_poll_completion 取走
+     * @param user_data 传给回调的用户数据
+     * @param out_ticket 输出票据，可为空
+     * @return 0表示成功，非0表示失败
+     * 
+     * 错误代码:
+     * - -100: SDK未初始化
+     * - -8: 参数错误
+     * - -10: 未完成的帧数已达上限，需等待结果被消费后再提交
+     * 
+     * 同一视频流（stream_id >= 0）的帧按提交顺序依次作用于该流的时序状态；
+     * stream_id < 0 的帧彼此独立。未完成的帧包括已提交但结果尚未被回调
+     * 或 ff_poll_completion 消费的帧。
+     */
+    FAST_FACE_API int ff_submit_frame(const FfFrameDesc* frame, FfCompletionCallback callback, void* user_data,
+                                      unsigned long long* out_ticket);
+
+    /**
+     * @brief 从完成队列取出一个结果
+     * @param ticket 输出票据，可为空
+     * @param stream_id 输出视频流ID，可为空
+     * @param status 输出该帧的返回码，可为空
+     * @param result_json 输出JSON结果的缓冲区
+     * @param json_buf_len 缓冲区长度
+     * @param timeout_ms 等待时间（毫秒），0表示不等待，负数表示一直等待
+     * @return 0表示取到结果，-11表示暂无结果，-9表示缓冲区太小（结果保留在队列中）
+     * 
+     * 返回-9时用 ff_peek_completion_size 查询所需长度，换用足够大的缓冲区重试；
+     * 结果不被取走时一直占用未完成帧的名额，之后的提交会返回-10。
+     */
+    FAST_FACE_API int ff_poll_completion(unsigned long long* ticket, int* stream_id, int* status,
+                                         char* result_json, int json_buf_len, int timeout_ms);
+
+    /**
+     * @brief 查询完成队列中下一个结果所需的缓冲区长度
+     * @param json_len 输出JSON结果的长度（含结尾的'\0'）
+     * @return 0表示成功，-11表示暂无结果，-8表示参数错误
+     */
+    FAST_FACE_API int ff_peek_completion_size(int* json_len);
+
+    /**
+     * @brief 设置异步分析最多同时未完成的帧数
+     * @param max_in_flight 上限，必须大于0
+     * @return 0表示成功，非0表示失败
+     */
+    FAST_FACE_API int ff_set_max_in_flight(int max_in_flight);
+
+    /**
+     * @brief 释放某一路视频流在SDK内部保存的状态
+     * @param stream_id 视频流ID
+     */
+    FAST_FACE_API void ff_release_stream(int stream_id);
+
+    /**
+     * @brief 设置内部工作线程数
+     * @param thread_count 线程数，0表示使用CPU核心数
+     * @return 0表示成功，-13表示在SDK工作线程（完成回调等）中调用，非0表示失败
+     * 
+     * 可在 sdk_init 之前调用；初始化之后调用会重建线程池，正在执行的批次不受影响。
+     * 旧线程池需要等待其工作线程退出，因此不能在工作线程上调用。
+     */
+    FAST_FACE_API int ff_set_worker_threads(int thread_count);
+
     /**
      * @brief 释放SDK资源
+     * @return 0表示成功，-13表示在SDK工作线程（完成回调等）中调用，此时不释放任何资源
      * 
      * 使用完毕后必须调用此函数释放资源，避免内存泄漏。
+     * 释放时需要等待工作线程退出，因此不能在工作线程上调用。
      */
-    FAST_FACE_API void sdk_release();
+    FAST_FACE_API int sdk_release();
 } 
\ No newline at end of file
@@ -1,13 +1,23 @@
 #include "../include/fast_face_sdk.h"
 #include <string>
 #include <mutex>
+#include <atomic>
 #include <vector>
 #include <deque>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <memory>
 #include <chrono>
 #include <ctime>
 #include <sstream>
 #include <iomanip>
+#include <fstream>
 #include <opencv2/opencv.hpp>
 #include <opencv2/face.hpp>
 #include <opencv2/dnn.hpp>
@@ -16,8 +26,18 @@
 #include <nlohmann/json.hpp>
 // #include <onnxruntime_cxx_api.h> // 需要ONNX Runtime头文件
 
+// fast_face_config.h 先于 FfStage 定义，阶段默认值只能写成数值，在此核对与枚举一致
+static_assert(FastFaceConfig::DEFAULT_STAGES == FF_STAGE_ALL, "DEFAULT_STAGES must enable every FfStage");
+static_assert(FastFaceConfig::GATED_STAGES == (FF_STAGE_LANDMARKS | FF_STAGE_POSE | FF_STAGE_MASK),
+              "GATED_STAGES must be FF_STAGE_LANDMARKS | FF_STAGE_POSE | FF_STAGE_MASK");
+
+// SDK模型目录，由CMake按安装前缀设置；未通过CMake构建时相对当前工作目录
+#ifndef FAST_FACE_MODEL_DIR
+#define FAST_FACE_MODEL_DIR "models"
+#endif
+
 // 全局变量
-static bool g_activated = false;
+static std::atomic<bool> g_activated{false};
 static std::string g_current_license_key;
 static std::mutex g_mutex;
 
@@ -35,15 +55,704 @@ struct LicenseInfo {
 
 static LicenseInfo g_license_info;
 
-// 模型相关
-static cv::CascadeClassifier g_face_cascade;
-static cv::CascadeClassifier g_eye_cascade;
-static cv::Ptr<cv::face::Facemark> g_facemark;
-static cv::dnn::Net g_mask_model;
+// 不可变快照：写入方发布新版本，读取方无锁获取当前版本
+// 读取方持有快照的引用，旧版本在最后一个引用释放后销毁
+template <typename T>
+class SnapshotCell {
+public:
+    SnapshotCell() = default;
+    explicit SnapshotCell(std::shared_ptr<const T> initial) : current_(std::move(initial)) {}
+    
+    std::shared_ptr<const T> load() const { return std::atomic_load(&current_); }
+    
+    // 发布空指针表示清除当前版本
+    void publish(std::shared_ptr<const T> snapshot) { std::atomic_store(&current_, std::move(snapshot)); }
+    
+private:
+    std::shared_ptr<const T> current_;      // 通过 std::atomic_load/atomic_store 访问
+};
+
+// 许可证快照：初始化时计算一次，分析热路径上只做时间戳比较
+struct LicenseSnapshot {
+    std::time_t expiry;
+    bool is_trial;
+    std::time_t trial_end;
+    std::string status;
+    std::string type;
+    std::string expires;
+};
+
+static SnapshotCell<LicenseSnapshot> g_license_snapshot;
+
+// 运行时可调参数
+struct RuntimeOptions {
+    int worker_threads = FastFaceConfig::WORKER_THREADS;
+    int max_in_flight = FastFaceConfig::MAX_IN_FLIGHT_FRAMES;
+};
+
+static SnapshotCell<RuntimeOptions> g_runtime_options(std::make_unique<RuntimeOptions>());
+
+// LBF关键点模型实例的借用池：fit 会改写实例内部状态（每个人脸的检测框），同一实例不能并发拟合
+// 借出时优先复用空闲实例，没有空闲实例时在锁外加载一份新的，归还后留在池中；
+// 锁只保护空闲列表的存取，拟合本身不持锁。实例数等于峰值并发拟合数，每个实例各占一份模型内存
+class FacemarkPool {
+public:
+    // 加载第一个实例，模型不可用时返回 false，之后 acquire 一律返回空
+    bool load(const std::string& model_path) {
+        model_path_ = model_path;
+        cv::Ptr<cv::face::Facemark> facemark = create();
+        if (!facemark) return false;
+        idle_.push_back(facemark);
+        available_ = true;
+        return true;
+    }
+    
+    bool available() const { return available_; }
+    
+    cv::Ptr<cv::face::Facemark> acquire() {
+        if (!available_) return nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!idle_.empty()) {
+                cv::Ptr<cv::face::Facemark> facemark = idle_.back();
+                idle_.pop_back();
+                return facemark;
+            }
+        }
+        return create();
+    }
+    
+    void release(const cv::Ptr<cv::face::Facemark>& facemark) {
+        if (!facemark) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_.push_back(facemark);
+    }
+    
+private:
+    cv::Ptr<cv::face::Facemark> create() const {
+        try {
+            cv::Ptr<cv::face::Facemark> facemark = cv::face::createFacemarkLBF();
+            facemark->loadModel(model_path_);
+            return facemark;
+        } catch (const cv::Exception&) {
+            return nullptr;
+        }
+    }
+    
+    std::string model_path_;
+    bool available_ = false;
+    std::mutex mutex_;
+    std::vector<cv::Ptr<cv::face::Facemark>> idle_;
+};
+
+// 从池中借出一个关键点模型实例，析构时归还
+class FacemarkLease {
+public:
+    explicit FacemarkLease(FacemarkPool& pool) : pool_(pool), facemark_(pool.acquire()) {}
+    ~FacemarkLease() { pool_.release(facemark_); }
+    FacemarkLease(const FacemarkLease&) = delete;
+    FacemarkLease& operator=(const FacemarkLease&) = delete;
+    
+    cv::face::Facemark* get() const { return facemark_.get(); }
+    
+private:
+    FacemarkPool& pool_;
+    cv::Ptr<cv::face::Facemark> facemark_;
+};
+
+// 模型相关（只读，由所有会话共享）
+struct SharedModels {
+    // 人脸检测后端配置，检测器本身按会话创建
+    int detector_backend;
+    std::string face_cascade_path;
+    std::string detector_model_path;
+    cv::Size detector_input_size;
+    
+    cv::CascadeClassifier eye_cascade;
+    // LBF关键点模型实例按需借出，拟合时各线程使用各自的实例，不争用全局锁
+    mutable FacemarkPool facemarks;
+    std::string mask_model_path;            // 口罩分类网络模型路径，为空时使用颜色启发式；网络本身按会话创建
+    int stages;                             // 可用的分析阶段（FfStage），会话只能启用其子集
+};
+
+static std::shared_ptr<const SharedModels> g_models;
+
+// 人脸检测器接口，每个会话持有一个实例（各实现均非线程安全）
+class FaceDetector {
+public:
+    virtual ~FaceDetector() = default;
+    
+    // 在灰度图上检测人脸，min_size 为最小人脸边长（像素）
+    virtual void detect(const cv::Mat& gray, int min_size, std::vector<cv::Rect>& faces) = 0;
+};
+
+// 级联分类器检测器
+class CascadeFaceDetector : public FaceDetector {
+public:
+    CascadeFaceDetector(double scale_factor, int min_neighbors)
+        : scale_factor_(scale_factor), min_neighbors_(min_neighbors) {}
+    
+    bool load(const std::string& path) { return cascade_.load(path); }
+    
+    void detect(const cv::Mat& gray, int min_size, std::vector<cv::Rect>& faces) override {
+        cascade_.detectMultiScale(gray, faces, scale_factor_, min_neighbors_, 0, cv::Size(min_size, min_size));
+    }
+    
+private:
+    cv::CascadeClassifier cascade_;
+    double scale_factor_;
+    int min_neighbors_;
+};
+
+// YuNet CNN检测器：检测图像按原宽高比缩小到不超过配置的输入尺寸后送入网络，
+// 网络输入尺寸随之设置（与上次相同时不重新设置），窗口和整帧都不变形
+class YuNetFaceDetector : public FaceDetector {
+public:
+    bool load(const std::string& model_path, const cv::Size& input_size) {
+        try {
+            net_ = cv::FaceDetectorYN::create(model_path, "", input_size,
+                                              (float)FastFaceConfig::YUNET_SCORE_THRESHOLD,
+                                              (float)FastFaceConfig::YUNET_NMS_THRESHOLD,
+                                              FastFaceConfig::YUNET_TOP_K,
+                                              cv::dnn::DNN_BACKEND_OPENCV, cv::dnn::DNN_TARGET_CPU);
+        } catch (const cv::Exception&) {
+            net_ = nullptr;
+        }
+        max_input_size_ = input_size;
+        current_size_ = input_size;
+        return !net_.empty();
+    }
+    
+    void detect(const cv::Mat& gray, int min_size, std::vector<cv::Rect>& faces) override {
+        faces.clear();
+        if (gray.empty()) return;
+        
+        // 等比缩放，只缩小不放大
+        double scale = std::min(1.0, std::min(max_input_size_.width / (double)gray.cols,
+                                              max_input_size_.height / (double)gray.rows));
+        cv::Size input_size(std::max(1, cvRound(gray.cols * scale)), std::max(1, cvRound(gray.rows * scale)));
+        const cv::Mat* resized = &gray;
+        if (input_size != gray.size()) {
+            cv::resize(gray, resized_, input_size, 0, 0, cv::INTER_AREA);
+            resized = &resized_;
+        }
+        if (input_size != current_size_) {
+            net_->setInputSize(input_size);
+            current_size_ = input_size;
+        }
+        
+        // 网络需要三通道输入，亮度复制到三个通道
+        cv::cvtColor(*resized, input_, cv::COLOR_GRAY2BGR);
+        net_->detect(input_, detections_);
+        
+        // 每行: x, y, w, h, 5个关键点, 置信度
+        double scale_x = gray.cols / (double)input_size.width;
+        double scale_y = gray.rows / (double)input_size.height;
+        const cv::Rect image_rect(0, 0, gray.cols, gray.rows);
+        for (int i = 0; i < detections_.rows; ++i) {
+            const float* row = detections_.ptr<float>(i);
+            cv::Rect face(cvRound(row[0] * scale_x), cvRound(row[1] * scale_y),
+                          cvRound(row[2] * scale_x), cvRound(row[3] * scale_y));
+            face &= image_rect;
+            if (face.width >= min_size && face.height >= min_size) faces.push_back(face);
+        }
+    }
+    
+private:
+    cv::Ptr<cv::FaceDetectorYN> net_;
+    cv::Size max_input_size_;                   // 网络输入的最大尺寸
+    cv::Size current_size_;                     // 网络当前的输入尺寸
+    cv::Mat resized_, input_, detections_;
+};
+
+// 按共享配置创建人脸检测器
+static int create_face_detector(const SharedModels& models, std::unique_ptr<FaceDetector>& out_detector) {
+    if (models.detector_backend == FF_DETECTOR_YUNET) {
+        auto detector = std::make_unique<YuNetFaceDetector>();
+        if (!detector->load(models.detector_model_path, models.detector_input_size)) {
+            return FastFaceError::FACE_CASCADE_LOAD_FAILED;
+        }
+        out_detector = std::move(detector);
+        return FastFaceError::SUCCESS;
+    }
+    
+    // LBP快速模式使用独立的检测参数
+    bool lbp = models.detector_backend == FF_DETECTOR_LBP;
+    auto detector = lbp
+        ? std::make_unique<CascadeFaceDetector>(FastFaceConfig::LBP_SCALE_FACTOR, FastFaceConfig::LBP_MIN_NEIGHBORS)
+        : std::make_unique<CascadeFaceDetector>(FastFaceConfig::FACE_DETECTION_SCALE_FACTOR,
+                                                FastFaceConfig::FACE_DETECTION_MIN_NEIGHBORS);
+    if (!detector->load(lbp ? models.detector_model_path : models.face_cascade_path)) {
+        return FastFaceError::FACE_CASCADE_LOAD_FAILED;
+    }
+    out_detector = std::move(detector);
+    return FastFaceError::SUCCESS;
+}
+
+// 统计分配次数的内存分配器：实际分配委托给OpenCV标准分配器，释放也由标准分配器完成
+// 只统计绑定到本分配器的会话缓冲区，OpenCV函数内部的临时内存和线程池的任务状态不在其中
+class CountingAllocator : public cv::MatAllocator {
+public:
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usage) const override {
+        count_.fetch_add(1, std::memory_order_relaxed);
+        return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usage);
+    }
+    
+    bool allocate(cv::UMatData* data, cv::AccessFlag flags, cv::UMatUsageFlags usage) const override {
+        return cv::Mat::getStdAllocator()->allocate(data, flags, usage);
+    }
+    
+    void deallocate(cv::UMatData* data) const override {
+        cv::Mat::getStdAllocator()->deallocate(data);
+    }
+    
+    int64_t count() const { return count_.load(std::memory_order_relaxed); }
+    
+    // 缓冲区此后的（重新）分配都经过本分配器
+    void bind(cv::Mat& mat) { mat.allocator = this; }
+    
+private:
+    mutable std::atomic<int64_t> count_{0};
+};
+
+// 从只增不减的字节存储中取出指定尺寸的连续图像头，存储只在容量不足时重新分配
+static cv::Mat pooled_mat(cv::Mat& storage, int rows, int cols, int type) {
+    size_t bytes = (size_t)rows * cols * CV_ELEM_SIZE(type);
+    if (storage.empty() || storage.total() < bytes) storage.create(1, (int)bytes, CV_8UC1);
+    return cv::Mat(rows, cols, type, storage.data);
+}
+
+// 单个人脸区域颜色转换的存储，按人脸下标复用
+struct ColorRoiBuffers {
+    cv::Mat packed;     // I420区域重新打包
+    cv::Mat bgr;
+};
+
+// 单个人脸LBF拟合的输入输出存储
+struct LandmarkFitBuffers {
+    std::vector<cv::Rect> faces;
+    std::vector<std::vector<cv::Point2f>> landmarks;
+};
+
+// 光流跟踪的临时缓冲区
+struct TrackBuffers {
+    std::vector<cv::Point2f> points;
+    std::vector<cv::Point2f> next_points;
+    std::vector<unsigned char> status;
+    std::vector<float> errors;
+    std::vector<float> dx, dy, scale;
+};
+
+// 运动估计的临时缓冲区
+struct MotionBuffers {
+    cv::Mat prev_small, small;
+    cv::Mat flow;
+    cv::Mat flow_parts[2];
+    cv::Mat magnitude;
+    cv::Mat prev_roi, roi;      // 相位相关的浮点区域存储，只增不减
+};
+
+// 每帧共享的特征平面：亮度平面只生成一次，积分图和平方积分图按需构建
+// 之后任意矩形的亮度均值和标准差都是O(1)查询，由各人脸和检测窗口共享；缓冲区跨帧复用
+struct FrameFeatures {
+    cv::Mat gray_buffer;                        // 需要转换时的亮度平面存储
+    cv::Mat gray;                               // 本帧亮度平面
+    cv::Mat sum_buffer;                         // 积分图存储，按最大区域只增不减
+    cv::Mat sqsum_buffer;
+    cv::Mat sum;                                // 人脸区域外接矩形的积分图 (CV_64F)
+    cv::Mat sqsum;                              // 平方积分图 (CV_64F)
+    cv::Rect integral_rect;                     // 积分图覆盖的帧内区域，为空时各人脸直接统计
+    bool has_stats = false;
+    
+    // 开始新的一帧，上一帧的积分图失效
+    void reset(const cv::Mat& frame_gray) {
+        gray = frame_gray;
+        integral_rect = cv::Rect();
+        has_stats = false;
+    }
+    
+    // 准备本帧各人脸的亮度统计；并行阶段只读，需在进入并行阶段前调用
+    // 只有人脸框相互重叠、外接矩形小于各人脸面积之和时，才在外接矩形上构建一次积分图供各人脸查询；
+    // 否则各人脸直接统计自身区域，不构建积分图
+    void prepare_stats(const std::vector<cv::Rect>& faces) {
+        if (has_stats || gray.empty()) return;
+        has_stats = true;
+        const cv::Rect frame_rect(0, 0, gray.cols, gray.rows);
+        cv::Rect bounds;
+        double face_area = 0.0;
+        for (const cv::Rect& face : faces) {
+            cv::Rect roi = face & frame_rect;
+            if (roi.area() <= 0) continue;
+            bounds = bounds.area() > 0 ? (bounds | roi) : roi;
+            face_area += roi.area();
+        }
+        if (bounds.area() <= 0 || bounds.area() >= face_area) return;
+        
+        sum = pooled_mat(sum_buffer, bounds.height + 1, bounds.width + 1, CV_64F);
+        sqsum = pooled_mat(sqsum_buffer, bounds.height + 1, bounds.width + 1, CV_64F);
+        cv::integral(gray(bounds), sum, sqsum, CV_64F, CV_64F);
+        integral_rect = bounds;
+    }
+    
+    // 矩形区域（裁剪到帧内）的亮度均值和标准差：区域在积分图范围内时查积分图，否则直接统计
+    bool box_stats(const cv::Rect& box, double& mean, double& stddev) const {
+        mean = stddev = 0.0;
+        if (!has_stats) return false;
+        cv::Rect roi = box & cv::Rect(0, 0, gray.cols, gray.rows);
+        if (roi.area() <= 0) return false;
+        
+        if ((roi & integral_rect) != roi) {
+            cv::Scalar roi_mean, roi_stddev;
+            cv::meanStdDev(gray(roi), roi_mean, roi_stddev);
+            mean = roi_mean[0];
+            stddev = roi_stddev[0];
+            return true;
+        }
+        const int x0 = roi.x - integral_rect.x, y0 = roi.y - integral_rect.y;
+        const int x1 = x0 + roi.width, y1 = y0 + roi.height;
+        double s = sum.at<double>(y1, x1) - sum.at<double>(y0, x1) - sum.at<double>(y1, x0) + sum.at<double>(y0, x0);
+        double sq = sqsum.at<double>(y1, x1) - sqsum.at<double>(y0, x1) - sqsum.at<double>(y1, x0) + sqsum.at<double>(y0, x0);
+        double count = (double)roi.area();
+        mean = s / count;
+        stddev = std::sqrt(std::max(0.0, sq / count - mean * mean));
+        return true;
+    }
+};
+
+// 相机模型：按帧尺寸和内参缓存，frame_size 为空表示需要重建
+struct CameraModel {
+    cv::Size frame_size;
+    cv::Matx33d camera_matrix;
+    cv::Vec4d dist_coeffs;
+};
+
+// 单个人脸的跨帧状态：关键点和姿态，作为下一帧同一人脸跟踪和 solvePnP 的初值
+struct FacePose {
+    cv::Rect bbox;
+    std::vector<cv::Point2f> landmarks;
+    int landmark_age = 0;                       // 关键点已连续跟踪的帧数，0表示本帧拟合得到
+    bool needs_fit = false;                     // 本帧需要重新拟合关键点，在逐人脸的并行阶段完成
+    cv::Vec3d rotation;
+    cv::Vec3d translation;
+    bool valid = false;
+    int mask_state = -1;                        // 网络分类的口罩结果：-1未分类，0未佩戴，1佩戴
+    int mask_age = 0;                           // 距上次分类的帧数
+    int track_id = 0;                           // 所属人脸轨迹
+};
+
+// 人脸质量指标
+struct FaceMetrics {
+    double sharpness;
+    double brightness;
+    double contrast;
+    double bright_ratio;        // 高亮像素比例，灰度输入的口罩检测使用
+    double distance;
+    bool has_sharpness;         // 清晰度和高亮像素比例已计算（未通过亮度门限的人脸可能不计算）
+};
+
+// 多人脸轨迹表：每条轨迹占一个槽位，各字段分别按数组存放（SoA）
+// 历史人脸框为每条轨迹 FACE_HISTORY_SIZE 个元素的环形缓冲区，连续存放在 history 中
+struct TrackTable {
+    static constexpr int HISTORY = FastFaceConfig::FACE_HISTORY_SIZE;
+    
+    std::vector<int> ids;                       // 轨迹ID，会话内递增、不复用
+    std::vector<int> misses;                    // 连续未关联的帧数
+    std::vector<int> heads;                     // 环形缓冲区的下一写入位置
+    std::vector<int> lengths;                   // 环形缓冲区中的有效帧数
+    std::vector<cv::Rect> boxes;                // 最近一次关联的人脸框
+    std::vector<cv::Rect> history;              // 槽位 i 的历史为 [i * HISTORY, (i + 1) * HISTORY)
+    int next_id = 1;
+    
+    int size() const { return (int)ids.size(); }
+    const cv::Rect* history_of(int slot) const { return &history[(size_t)slot * HISTORY]; }
+    
+    // 新建轨迹，返回槽位
+    int add(const cv::Rect& box) {
+        int slot = size();
+        ids.push_back(next_id++);
+        misses.push_back(0);
+        heads.push_back(0);
+        lengths.push_back(0);
+        boxes.push_back(box);
+        history.resize((size_t)(slot + 1) * HISTORY);
+        push(slot, box);
+        return slot;
+    }
+    
+    // 把本帧人脸框写入轨迹
+    void push(int slot, const cv::Rect& box) {
+        history[(size_t)slot * HISTORY + heads[slot]] = box;
+        heads[slot] = (heads[slot] + 1) % HISTORY;
+        lengths[slot] = std::min(lengths[slot] + 1, HISTORY);
+        boxes[slot] = box;
+        misses[slot] = 0;
+    }
+    
+    // 删除轨迹，最后一个槽位移入空出的位置
+    void remove(int slot) {
+        int last = size() - 1;
+        if (slot != last) {
+            ids[slot] = ids[last];
+            misses[slot] = misses[last];
+            heads[slot] = heads[last];
+            lengths[slot] = lengths[last];
+            boxes[slot] = boxes[last];
+            std::copy(history_of(last), history_of(last) + HISTORY, history.begin() + (size_t)slot * HISTORY);
+        }
+        ids.pop_back();
+        misses.pop_back();
+        heads.pop_back();
+        lengths.pop_back();
+        boxes.pop_back();
+        history.resize((size_t)last * HISTORY);
+    }
+    
+    void clear() {
+        ids.clear();
+        misses.clear();
+        heads.clear();
+        lengths.clear();
+        boxes.clear();
+        history.clear();
+    }
+};
+
+// 最佳抓拍：一条轨迹的一个候选帧，人脸图像保存在会话的图像槽位中
+struct BestShot {
+    int track_id;
+    int frame_index;
+    double score;
+    FfFaceResult face;
+    int slot;                                   // shot_storage 中的槽位
+    int width;
+    int height;
+};
+
+// 人脸框与轨迹的候选关联
+struct TrackCandidate {
+    double distance;                            // 中心距离（相对轨迹人脸宽度）
+    int slot;
+    int face;
+};
+
+// 分析会话：每路视频流独立持有检测器和时序状态
+struct FfSession {
+    CountingAllocator allocator;                     // 会话缓冲区的分配器，需先于各缓冲区构造、后于其析构
+    std::mutex mutex;                                // 串行化同一会话上的调用
+    std::shared_ptr<const SharedModels> models;
+    std::unique_ptr<FaceDetector> detector;          // 检测器非线程安全，每个会话一份
+    cv::dnn::Net mask_model;                         // 口罩分类网络，同样每个会话一份；为空时使用颜色启发式
+    FfSessionParams params;
+
+    // 历史记录
+    TrackTable tracks;
+    std::vector<int> face_slots;                // 本帧各人脸所属的轨迹槽位
+    std::vector<TrackCandidate> track_candidates;
+    std::vector<unsigned char> track_matched;
+    int frame_count = 0;                        // 已分析的帧数
+    
+    // 最佳抓拍
+    std::vector<BestShot> best_shots;           // 各轨迹正在挑选的候选帧
+    std::deque<BestShot> ready_shots;           // 已输出、等待取走的抓拍
+    std::vector<cv::Mat> shot_storage;          // 人脸图像存储，共 BEST_SHOT_POOL_SIZE 个槽位，只增不减
+    std::vector<int> free_shot_slots;
+    cv::Mat prev_gray;
+    std::vector<FacePose> poses;                // 本帧各人脸的姿态
+    std::vector<FacePose> prev_poses;           // 上一帧各人脸的姿态
+    CameraModel camera;
+    
+    // 检测-跟踪状态
+    std::vector<cv::Rect> faces;                // 当前人脸框，非关键帧由上一帧跟踪得到
+    int frames_since_detection = 0;
+    int detections_since_full_scan = 0;
+
+    // 临时缓冲区
+    FrameFeatures features;                     // 本帧共享的亮度平面和积分图
+    cv::Mat detect_gray;                        // 缩放后的检测图像
+    cv::Mat enhanced_gray;                      // 低照度增强后的检测图像
+    cv::Ptr<cv::CLAHE> clahe;                   // 低照度增强的CLAHE实例，首次使用时创建
+    std::vector<cv::Rect> detections;           // 检测图像坐标下的检测结果
+    std::vector<cv::Rect> windows;              // 局部检测窗口
+    std::vector<cv::Rect> window_faces;
+    TrackBuffers track;
+    MotionBuffers motion;
+    std::vector<double> face_motion;            // 本帧各人脸的运动幅度
+    std::vector<LandmarkFitBuffers> fit_buffers;    // 各人脸的LBF拟合存储，只增不减
+    std::vector<FaceMetrics> face_metrics;      // 本帧各人脸的质量指标
+    std::vector<cv::Mat> mask_crops;            // 本帧待分类的人脸区域（BGR）
+    std::vector<int> mask_indices;
+    cv::Mat mask_blob;                          // 口罩网络输入批次存储，按最大批次只增不减
+    cv::Mat mask_resized;                       // 缩放到网络输入尺寸的人脸区域
+    cv::Mat mask_scaled;                        // 归一化到[0,1]的人脸区域
+    std::vector<ColorRoiBuffers> color_buffers; // 各人脸区域的颜色转换存储，只增不减
+    std::vector<FfFaceResult> results;          // 最近一帧的分析结果
+};
+
+// 默认会话，供 analyze_frame 使用（通过 std::atomic_load/atomic_store 访问）
+static std::shared_ptr<FfSession> g_default_session;
+
+// 批量分析使用的会话：按视频流ID保存的有状态会话，以及无状态帧复用的空闲会话
+static std::unordered_map<int, std::shared_ptr<FfSession>> g_stream_sessions;
+static std::vector<std::unique_ptr<FfSession>> g_idle_sessions;
+
+// 工作线程池
+class WorkerPool {
+public:
+    explicit WorkerPool(int thread_count) {
+        for (int i = 0; i < thread_count; ++i) {
+            threads_.emplace_back([this]() { run(); });
+        }
+    }
+    
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto& thread : threads_) thread.join();
+    }
+    
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+    }
+    
+    int size() const { return (int)threads_.size(); }
+    
+    // 当前线程所属的线程池，非工作线程为空
+    static WorkerPool*& current() {
+        static thread_local WorkerPool* pool = nullptr;
+        return pool;
+    }
+    
+    // 并行执行 body(0) ... body(count-1)，调用线程同时参与执行
+    // 只等待已被领取的索引完成，不等待仍在排队的辅助任务，因此可在工作线程内调用而不会死锁
+    void parallel_for(int count, const std::function<void(int)>& body) {
+        if (count <= 0) return;
+        
+        struct State {
+            std::atomic<int> next{0};
+            int count;
+            int done = 0;
+            const std::function<void(int)>* body;
+            std::exception_ptr error;
+            std::mutex mutex;
+            std::condition_variable cv;
+        };
+        auto state = std::make_shared<State>();
+        state->count = count;
+        state->body = &body;
+        
+        // 全部索引完成后 body 不再被访问，排队中的辅助任务领取不到索引会直接返回
+        auto work = [state]() {
+            for (;;) {
+                int index = state->next++;
+                if (index >= state->count) return;
+                
+                std::exception_ptr error;
+                try {
+                    (*state->body)(index);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (error && !state->error) state->error = error;
+                if (++state->done == state->count) state->cv.notify_all();
+            }
+        };
+        
+        int helpers = std::min(count - 1, size());
+        for (int i = 0; i < helpers; ++i) submit(work);
+        work();
+        
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->cv.wait(lock, [&]() { return state->done == state->count; });
+        if (state->error) std::rethrow_exception(state->error);
+    }
+    
+private:
+    void run() {
+        current() = this;
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+                // 停止时先处理完剩余任务再退出
+                if (tasks_.empty()) return;
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+    
+    std::vector<std::thread> threads_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+};
+
+static std::shared_ptr<WorkerPool> g_worker_pool;      // 通过 std::atomic_load/atomic_store 访问
 
-// 历史记录
-static std::deque<cv::Rect> g_face_history;
-static cv::Mat g_prev_gray;
+// 异步分析任务
+struct AsyncJob {
+    unsigned long long ticket;
+    int stream_id;
+    cv::Mat planes[3];                  // 提交时复制，调用方可立即复用缓冲区
+    FfImage image;                      // 指向 planes 的图像描述
+    FfCompletionCallback callback;
+    void* user_data;
+};
+
+// 已完成但尚未被取走的结果
+struct AsyncCompletion {
+    unsigned long long ticket;
+    int stream_id;
+    int status;
+    std::string result_json;
+};
+
+// 每路视频流的待处理队列，保证同一流的帧按提交顺序分析
+struct StreamStrand {
+    std::deque<AsyncJob> pending;
+    bool running = false;
+};
+
+static std::mutex g_async_mutex;
+static std::condition_variable g_completion_cv;
+static std::unordered_map<int, StreamStrand> g_strands;
+static std::deque<AsyncCompletion> g_completions;
+static std::atomic<unsigned long long> g_next_ticket{1};
+static std::atomic<int> g_in_flight{0};
+
+// 等待一组任务完成
+class TaskLatch {
+public:
+    explicit TaskLatch(int count) : remaining_(count) {}
+    
+    void count_down() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--remaining_ == 0) cv_.notify_all();
+    }
+    
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return remaining_ == 0; });
+    }
+    
+private:
+    int remaining_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
 
 // 常量定义
 const int STABLE_FRAMES_THRESHOLD = 3;
@@ -105,195 +814,1747 @@ void init_trial_period() {
     g_license_info.expires = ss.str();
 }
 
-// 计算图像清晰度
-double calculate_sharpness(const cv::Mat& image) {
-    cv::Mat gray, laplacian;
-    cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-    cv::Laplacian(gray, laplacian, CV_64F);
-    cv::Scalar mean, stddev;
-    cv::meanStdDev(laplacian, mean, stddev);
-    return stddev.val[0] * stddev.val[0];
+// 输入帧视图：各平面均为调用方缓冲区上的零拷贝视图
+struct FrameView {
+    int format = FF_PIXEL_BGR;
+    cv::Mat planes[3];
+    cv::Mat gray;           // 亮度平面，灰度/YUV 4:2:0输入时直接引用原始数据
+};
+
+// 按像素格式解析各平面，校验尺寸与行跨度
+static int get_image_planes(const FfImage& image, cv::Mat planes[3]) {
+    const int width = image.width;
+    const int height = image.height;
+    if (width <= 0 || height <= 0 || !image.planes[0]) return FastFaceError::INVALID_PARAMETERS;
+    for (int i = 0; i < 3; ++i) {
+        if (image.strides[i] < 0) return FastFaceError::INVALID_PARAMETERS;
+    }
+    
+    auto make_plane = [](int rows, int cols, int type, const unsigned char* data, int stride, int min_stride, cv::Mat& out) {
+        if (stride == 0) stride = min_stride;
+        if (stride < min_stride) return false;
+        out = cv::Mat(rows, cols, type, (void*)data, (size_t)stride);
+        return true;
+    };
+    
+    const int stride0 = image.strides[0];
+    switch (image.format) {
+    case FF_PIXEL_BGR:
+        return make_plane(height, width, CV_8UC3, image.planes[0], stride0, width * 3, planes[0])
+            ? FastFaceError::SUCCESS : FastFaceError::INVALID_PARAMETERS;
+    case FF_PIXEL_GRAY:
+        return make_plane(height, width, CV_8UC1, image.planes[0], stride0, width, planes[0])
+            ? FastFaceError::SUCCESS : FastFaceError::INVALID_PARAMETERS;
+    case FF_PIXEL_YUYV:
+        if (width % 2 != 0) return FastFaceError::INVALID_PARAMETERS;
+        return make_plane(height, width, CV_8UC2, image.planes[0], stride0, width * 2, planes[0])
+            ? FastFaceError::SUCCESS : FastFaceError::INVALID_PARAMETERS;
+    case FF_PIXEL_NV12:
+    case FF_PIXEL_NV21: {
+        if (width % 2 != 0 || height % 2 != 0) return FastFaceError::INVALID_PARAMETERS;
+        if (!make_plane(height, width, CV_8UC1, image.planes[0], stride0, width, planes[0])) {
+            return FastFaceError::INVALID_PARAMETERS;
+        }
+        const int luma_stride = (int)planes[0].step;
+        const unsigned char* uv = image.planes[1] ? image.planes[1] : image.planes[0] + (size_t)luma_stride * height;
+        int uv_stride = image.strides[1] ? image.strides[1] : luma_stride;
+        return make_plane(height / 2, width / 2, CV_8UC2, uv, uv_stride, width, planes[1])
+            ? FastFaceError::SUCCESS : FastFaceError::INVALID_PARAMETERS;
+    }
+    case FF_PIXEL_I420: {
+        if (width % 2 != 0 || height % 2 != 0) return FastFaceError::INVALID_PARAMETERS;
+        if (!make_plane(height, width, CV_8UC1, image.planes[0], stride0, width, planes[0])) {
+            return FastFaceError::INVALID_PARAMETERS;
+        }
+        const int luma_stride = (int)planes[0].step;
+        const unsigned char* u = image.planes[1] ? image.planes[1] : image.planes[0] + (size_t)luma_stride * height;
+        int u_stride = image.strides[1] ? image.strides[1] : luma_stride / 2;
+        if (!make_plane(height / 2, width / 2, CV_8UC1, u, u_stride, width / 2, planes[1])) {
+            return FastFaceError::INVALID_PARAMETERS;
+        }
+        const unsigned char* v = image.planes[2] ? image.planes[2] : u + (size_t)planes[1].step * (height / 2);
+        int v_stride = image.strides[2] ? image.strides[2] : (int)planes[1].step;
+        return make_plane(height / 2, width / 2, CV_8UC1, v, v_stride, width / 2, planes[2])
+            ? FastFaceError::SUCCESS : FastFaceError::INVALID_PARAMETERS;
+    }
+    default:
+        return FastFaceError::INVALID_PARAMETERS;
+    }
+}
+
+// 构建帧视图，需要转换时亮度平面写入 gray_buffer
+static int make_frame_view(const FfImage& image, cv::Mat& gray_buffer, FrameView& view) {
+    int result = get_image_planes(image, view.planes);
+    if (result != FastFaceError::SUCCESS) return result;
+    
+    view.format = image.format;
+    switch (image.format) {
+    case FF_PIXEL_BGR:
+        cv::cvtColor(view.planes[0], gray_buffer, cv::COLOR_BGR2GRAY);
+        view.gray = gray_buffer;
+        break;
+    case FF_PIXEL_YUYV:
+        // 亮度与色度交错存储，只能抽取一次
+        cv::extractChannel(view.planes[0], gray_buffer, 0);
+        view.gray = gray_buffer;
+        break;
+    default:
+        view.gray = view.planes[0];
+        break;
+    }
+    return FastFaceError::SUCCESS;
+}
+
+// 将帧视图中的一个区域转换为BGR，只在需要颜色的阶段调用
+// 需要转换时结果写入 buffers 中复用的存储，bgr_roi 只在 buffers 下次使用前有效
+static void extract_color_roi(const FrameView& view, const cv::Rect& roi, ColorRoiBuffers& buffers, cv::Mat& bgr_roi) {
+    if (view.format == FF_PIXEL_BGR) {
+        bgr_roi = view.planes[0](roi);
+        return;
+    }
+    if (view.format == FF_PIXEL_GRAY) {
+        bgr_roi = pooled_mat(buffers.bgr, roi.height, roi.width, CV_8UC3);
+        cv::cvtColor(view.gray(roi), bgr_roi, cv::COLOR_GRAY2BGR);
+        return;
+    }
+    
+    // 色度子采样，转换区域对齐到偶数坐标
+    int x0 = roi.x & ~1;
+    int y0 = roi.y & ~1;
+    int x1 = std::min(view.gray.cols, (roi.x + roi.width + 1) & ~1);
+    int y1 = std::min(view.gray.rows, (roi.y + roi.height + 1) & ~1);
+    cv::Rect aligned(x0, y0, x1 - x0, y1 - y0);
+    cv::Rect chroma(x0 / 2, y0 / 2, aligned.width / 2, aligned.height / 2);
+    
+    cv::Mat bgr = pooled_mat(buffers.bgr, aligned.height, aligned.width, CV_8UC3);
+    switch (view.format) {
+    case FF_PIXEL_NV12:
+    case FF_PIXEL_NV21:
+        cv::cvtColorTwoPlane(view.planes[0](aligned), view.planes[1](chroma), bgr,
+                             view.format == FF_PIXEL_NV12 ? cv::COLOR_YUV2BGR_NV12 : cv::COLOR_YUV2BGR_NV21);
+        break;
+    case FF_PIXEL_I420: {
+        // 把区域重新打包为连续的I420小图
+        cv::Mat packed = pooled_mat(buffers.packed, aligned.height * 3 / 2, aligned.width, CV_8UC1);
+        size_t luma_size = (size_t)aligned.area();
+        size_t chroma_size = (size_t)chroma.area();
+        view.planes[0](aligned).copyTo(packed.rowRange(0, aligned.height));
+        cv::Mat u(chroma.height, chroma.width, CV_8UC1, packed.data + luma_size);
+        cv::Mat v(chroma.height, chroma.width, CV_8UC1, packed.data + luma_size + chroma_size);
+        view.planes[1](chroma).copyTo(u);
+        view.planes[2](chroma).copyTo(v);
+        cv::cvtColor(packed, bgr, cv::COLOR_YUV2BGR_I420);
+        break;
+    }
+    case FF_PIXEL_YUYV:
+        cv::cvtColor(view.planes[0](aligned), bgr, cv::COLOR_YUV2BGR_YUYV);
+        break;
+    }
+    bgr_roi = bgr(cv::Rect(roi.x - x0, roi.y - y0, roi.width, roi.height));
+}
+
+// 人脸区域的亮度统计（均值和标准差由 FrameFeatures 的积分图查询）
+struct RoiStats {
+    double laplacian_variance;  // 拉普拉斯响应方差（清晰度）
+    double bright_ratio;        // 亮度不低于 WHITE_MASK_V_MIN 的像素比例
+};
+
+// 单次遍历灰度区域，同时计算拉普拉斯方差和高亮像素比例
+// 拉普拉斯核与 cv::Laplacian(ksize=1) 相同，区域按独立图像以 BORDER_REFLECT_101 处理边界；
+// 逐像素响应为整数并精确累加，方差与 CV_64F 的 cv::Laplacian + cv::meanStdDev 只差浮点舍入（test_sdk 核对）；
+// 内层循环无分支，便于编译器自动向量化
+static void gray_roi_stats(const cv::Mat& gray, RoiStats& stats) {
+    const int rows = gray.rows;
+    const int cols = gray.cols;
+    stats = RoiStats();
+    if (rows <= 0 || cols <= 0) return;
+    
+    const int bright_min = FastFaceConfig::WHITE_MASK_V_MIN;
+    int64_t lap_sum = 0, lap_sq = 0, bright = 0;
+    for (int y = 0; y < rows; ++y) {
+        const unsigned char* up = gray.ptr<unsigned char>(y > 0 ? y - 1 : std::min(1, rows - 1));
+        const unsigned char* row = gray.ptr<unsigned char>(y);
+        const unsigned char* down = gray.ptr<unsigned char>(y < rows - 1 ? y + 1 : std::max(rows - 2, 0));
+        
+        // 首尾两列的左右邻居反射后相同
+        int first_neighbor = cols > 1 ? 1 : 0;
+        int edge0 = up[0] + down[0] + 2 * row[first_neighbor] - 4 * row[0];
+        lap_sum += edge0;
+        lap_sq += edge0 * edge0;
+        if (cols > 1) {
+            int last = cols - 1;
+            int edge1 = up[last] + down[last] + 2 * row[last - 1] - 4 * row[last];
+            lap_sum += edge1;
+            lap_sq += edge1 * edge1;
+        }
+        
+        for (int x = 1; x < cols - 1; ++x) {
+            int lap = up[x] + down[x] + row[x - 1] + row[x + 1] - 4 * row[x];
+            lap_sum += lap;
+            lap_sq += lap * lap;
+        }
+        for (int x = 0; x < cols; ++x) {
+            bright += row[x] >= bright_min;
+        }
+    }
+    
+    double count = (double)rows * cols;
+    double lap_mean = lap_sum / count;
+    stats.laplacian_variance = std::max(0.0, lap_sq / count - lap_mean * lap_mean);
+    stats.bright_ratio = bright / count;
+}
+
+// OpenCV 8位 BGR->HSV 转换使用的定点除法表
+struct HsvTables {
+    static const int SHIFT = 12;
+    int sdiv[256];
+    int hdiv[256];
+    
+    HsvTables() {
+        sdiv[0] = hdiv[0] = 0;
+        for (int i = 1; i < 256; ++i) {
+            sdiv[i] = cvRound((255 << SHIFT) / (1.0 * i));
+            hdiv[i] = cvRound((180 << SHIFT) / (6.0 * i));
+        }
+    }
+};
+
+static const HsvTables& hsv_tables() {
+    static const HsvTables tables;
+    return tables;
+}
+
+// 单次遍历BGR区域，统计蓝色/白色口罩颜色的像素比例
+// HSV按 OpenCV 8位 BGR->HSV 转换的定点公式计算，判定条件同 cv::inRange 的闭区间，不生成中间图像
+static void mask_color_ratios(const cv::Mat& bgr, double& blue_ratio, double& white_ratio) {
+    blue_ratio = white_ratio = 0.0;
+    if (bgr.empty()) return;
+    
+    const HsvTables& tables = hsv_tables();
+    const int round = 1 << (HsvTables::SHIFT - 1);
+    int64_t blue = 0, white = 0;
+    for (int y = 0; y < bgr.rows; ++y) {
+        const unsigned char* pixel = bgr.ptr<unsigned char>(y);
+        for (int x = 0; x < bgr.cols; ++x, pixel += 3) {
+            int b = pixel[0], g = pixel[1], r = pixel[2];
+            int v = std::max(b, std::max(g, r));
+            int diff = v - std::min(b, std::min(g, r));
+            int vr = v == r ? -1 : 0;
+            int vg = v == g ? -1 : 0;
+            
+            int s = (diff * tables.sdiv[v] + round) >> HsvTables::SHIFT;
+            int h = (vr & (g - b)) + (~vr & ((vg & (b - r + 2 * diff)) + ((~vg) & (r - g + 4 * diff))));
+            h = (h * tables.hdiv[diff] + round) >> HsvTables::SHIFT;
+            h += h < 0 ? 180 : 0;
+            
+            blue += h >= FastFaceConfig::BLUE_MASK_H_MIN && h <= FastFaceConfig::BLUE_MASK_H_MAX &&
+                    s >= FastFaceConfig::BLUE_MASK_S_MIN && v >= FastFaceConfig::BLUE_MASK_V_MIN;
+            white += s <= FastFaceConfig::WHITE_MASK_S_MAX && v >= FastFaceConfig::WHITE_MASK_V_MIN;
+        }
+    }
+    
+    double count = (double)bgr.rows * bgr.cols;
+    blue_ratio = blue / count;
+    white_ratio = white / count;
+}
+
+// 低照度增强的gamma查找表（256项，只构建一次）
+static const cv::Mat& low_light_gamma_lut() {
+    static const cv::Mat lut = []() {
+        cv::Mat table(1, 256, CV_8U);
+        for (int i = 0; i < 256; ++i) {
+            table.at<unsigned char>(i) = (unsigned char)cvRound(std::pow(i / 255.0, 1.0 / FastFaceConfig::LOW_LIGHT_GAMMA) * 255.0);
+        }
+        return table;
+    }();
+    return lut;
+}
+
+// 低照度增强：亮度平面上做CLAHE后查表gamma校正，CLAHE实例由调用方缓存
+static void enhance_low_light(cv::Ptr<cv::CLAHE>& clahe, const cv::Mat& gray, cv::Mat& enhanced) {
+    if (!clahe) {
+        clahe = cv::createCLAHE(FastFaceConfig::LOW_LIGHT_CLAHE_CLIP,
+                                cv::Size(FastFaceConfig::LOW_LIGHT_CLAHE_TILES, FastFaceConfig::LOW_LIGHT_CLAHE_TILES));
+    }
+    clahe->apply(gray, enhanced);
+    cv::LUT(enhanced, low_light_gamma_lut(), enhanced);
+}
+
+// 判断本帧检测前是否需要低照度增强
+static bool needs_low_light(const FfSessionParams& params, const cv::Mat& gray) {
+    switch (params.low_light_mode) {
+    case FF_LOW_LIGHT_ALWAYS:
+        return true;
+    case FF_LOW_LIGHT_AUTO:
+        return cv::mean(gray)[0] < FastFaceConfig::BRIGHTNESS_MIN;
+    default:
+        return false;
+    }
+}
+
+// 3D模型点（简化的人脸模型）
+static const std::vector<cv::Point3f>& face_model_points() {
+    static const std::vector<cv::Point3f> points = {
+        cv::Point3f(0.0f, 0.0f, 0.0f),           // 鼻子
+        cv::Point3f(0.0f, -330.0f, -65.0f),      // 下巴
+        cv::Point3f(-165.0f, 170.0f, -135.0f),   // 左眼
+        cv::Point3f(165.0f, 170.0f, -135.0f),    // 右眼
+        cv::Point3f(-150.0f, -150.0f, -125.0f),  // 左嘴角
+        cv::Point3f(150.0f, -150.0f, -125.0f)    // 右嘴角
+    };
+    return points;
+}
+
+// 按帧尺寸和会话参数更新相机模型，两者都未变化时直接复用
+static void update_camera_model(CameraModel& camera, const FfSessionParams& params, const cv::Size& frame_size) {
+    if (camera.frame_size == frame_size) return;
+    
+    double fx = frame_size.width;
+    double fy = frame_size.width;
+    cv::Point2d center(frame_size.width / 2, frame_size.height / 2);
+    if (params.focal_length_x > 0.0) {
+        fx = params.focal_length_x;
+        fy = params.focal_length_y > 0.0 ? params.focal_length_y : fx;
+        // 主点为负数表示未标定，仍使用图像中心
+        if (params.principal_x >= 0.0) center.x = params.principal_x;
+        if (params.principal_y >= 0.0) center.y = params.principal_y;
+    }
+    
+    camera.camera_matrix = cv::Matx33d(fx, 0, center.x,
+                                       0, fy, center.y,
+                                       0, 0, 1);
+    camera.dist_coeffs = cv::Vec4d();    // 无畸变
+    camera.frame_size = frame_size;
+}
+
+// 在上一帧的人脸中查找同一轨迹的一个
+static const FacePose* find_previous_pose(const std::vector<FacePose>& poses, int track_id) {
+    for (const FacePose& pose : poses) {
+        if (pose.track_id == track_id) return &pose;
+    }
+    return nullptr;
+}
+
+// 估计头部姿态，pose.valid 为真时以 pose 中的旋转/平移作为 solvePnP 迭代的初值，结果写回 pose
+std::tuple<double, double, double> estimate_pose(const std::vector<cv::Point2f>& landmarks, const CameraModel& camera,
+                                                 FacePose& pose) {
+    bool use_guess = pose.valid;
+    pose.valid = false;
+    try {
+        // 简化的头部姿态估计，使用眼睛和鼻子关键点
+        if (landmarks.size() < 6) return {0.0, 0.0, 0.0};
+        
+        // 2D图像点（前6个关键点，不复制）
+        cv::Mat image_points(1, 6, CV_32FC2, const_cast<cv::Point2f*>(landmarks.data()));
+        
+        cv::solvePnP(face_model_points(), image_points, camera.camera_matrix, camera.dist_coeffs, 
+                     pose.rotation, pose.translation, use_guess, cv::SOLVEPNP_ITERATIVE);
+        
+        // 转换为欧拉角
+        cv::Matx33d rotation_matrix;
+        cv::Rodrigues(pose.rotation, rotation_matrix);
+        
+        // 简化的欧拉角计算
+        double yaw = atan2(rotation_matrix(2, 1), rotation_matrix(2, 2)) * 180.0 / CV_PI;
+        double pitch = atan2(-rotation_matrix(2, 0), 
+                           sqrt(rotation_matrix(2, 1) * rotation_matrix(2, 1) + 
+                                rotation_matrix(2, 2) * rotation_matrix(2, 2))) * 180.0 / CV_PI;
+        double roll = atan2(rotation_matrix(1, 0), rotation_matrix(0, 0)) * 180.0 / CV_PI;
+        
+        pose.valid = true;
+        return {yaw, pitch, roll};
+    } catch (...) {
+        return {0.0, 0.0, 0.0};
+    }
+}
+
+// 计算人脸的低代价质量指标：亮度和对比度见 FrameFeatures::box_stats，清晰度另由 measure_face_sharpness 计算
+FaceMetrics measure_face_brightness(const FrameFeatures& features, const cv::Rect& face_roi) {
+    FaceMetrics metrics = FaceMetrics();
+    features.box_stats(face_roi, metrics.brightness, metrics.contrast);
+    
+    // 简化的距离估计
+    metrics.distance = FastFaceConfig::DEFAULT_DISTANCE_CM;
+    
+    return metrics;
+}
+
+// 在亮度平面上单次遍历人脸区域，计算清晰度和高亮像素比例
+void measure_face_sharpness(const FrameView& frame, const cv::Rect& face_roi, FaceMetrics& metrics) {
+    RoiStats stats;
+    gray_roi_stats(frame.gray(face_roi), stats);
+    metrics.sharpness = stats.laplacian_variance;
+    metrics.bright_ratio = stats.bright_ratio;
+    metrics.has_sharpness = true;
+}
+
+// 简化的口罩检测（基于颜色和形状），未配置分类网络时使用
+bool detect_mask_by_color(const FrameView& frame, const cv::Rect& face_roi, const FaceMetrics& metrics,
+                          ColorRoiBuffers& color_buffers) {
+    try {
+        double blue_ratio = 0.0, white_ratio = 0.0;
+        if (frame.format == FF_PIXEL_GRAY) {
+            // 灰度图的饱和度为0，只可能命中白色范围
+            white_ratio = metrics.bright_ratio;
+        } else {
+            cv::Mat face_img;
+            extract_color_roi(frame, face_roi, color_buffers, face_img);
+            mask_color_ratios(face_img, blue_ratio, white_ratio);
+        }
+        
+        return (blue_ratio > FastFaceConfig::BLUE_MASK_RATIO_THRESHOLD || 
+                white_ratio > FastFaceConfig::WHITE_MASK_RATIO_THRESHOLD);
+    } catch (...) {
+        return false;
+    }
+}
+
+// 判断人脸是否稳定，history 为同一轨迹的历史人脸框（含本帧）
+bool is_face_stable(const cv::Rect& current_bbox, const cv::Rect* history, int count) {
+    if (count < FastFaceConfig::STABLE_FRAMES_THRESHOLD) return false;
+    
+    double total_movement = 0.0;
+    for (int i = 0; i < count; ++i) {
+        const cv::Rect& prev_bbox = history[i];
+        double dx = abs(current_bbox.x - prev_bbox.x) / (double)current_bbox.width;
+        double dy = abs(current_bbox.y - prev_bbox.y) / (double)current_bbox.height;
+        total_movement += dx + dy;
+    }
+    
+    return (total_movement / count) < FastFaceConfig::STABILITY_THRESHOLD;
+}
+
+// 评分函数
+double sharpness_score(double sharpness_value) {
+    return std::min(100.0, std::max(0.0, sharpness_value / 10.0));
+}
+
+double brightness_score(double brightness_value) {
+    if (brightness_value < FastFaceConfig::BRIGHTNESS_MIN) return 0.0;
+    if (brightness_value > FastFaceConfig::BRIGHTNESS_MAX) return 0.0;
+    return 100.0 - abs(brightness_value - FastFaceConfig::BRIGHTNESS_OPTIMAL) / FastFaceConfig::BRIGHTNESS_OPTIMAL * 100.0;
+}
+
+double contrast_score(double std_val) {
+    if (std_val < 20) return 0.0;
+    if (std_val > 100) return 100.0;
+    return (std_val - 20) / 80.0 * 100.0;
+}
+
+// 按代价从低到高检查质量门限，返回需要跳过的阶段：先比较人脸框尺寸，再查亮度，
+// 两者都通过且设置了清晰度门限时才遍历人脸区域计算清晰度
+static int gate_face_stages(const FfSessionParams& params, const FrameView& frame, const cv::Rect& face,
+                            FaceMetrics& metrics) {
+    bool passed = std::min(face.width, face.height) >= params.gate_min_face_size &&
+                  brightness_score(metrics.brightness) >= params.gate_min_brightness_score;
+    if (passed && params.gate_min_sharpness_score > 0.0) {
+        measure_face_sharpness(frame, face, metrics);
+        passed = sharpness_score(metrics.sharpness) >= params.gate_min_sharpness_score;
+    }
+    if (passed) return 0;
+    
+    // 姿态依赖关键点；会话未启用的阶段不计入
+    int skipped = params.gated_stages;
+    if (skipped & FF_STAGE_LANDMARKS) skipped |= FF_STAGE_POSE;
+    return skipped & params.stages;
+}
+
+// 最佳抓拍的综合评分（0-100），质量评分直接取自本帧指标（会话可能未启用质量阶段）
+// has_pose 为假（姿态阶段未执行）时不计姿态项，其余各项按权重之和重新归一化
+static double best_shot_score(const FfFaceResult& face, const FaceMetrics& metrics, bool has_pose) {
+    double score = FastFaceConfig::BEST_SHOT_WEIGHT_SHARPNESS * sharpness_score(metrics.sharpness) +
+                   FastFaceConfig::BEST_SHOT_WEIGHT_BRIGHTNESS * brightness_score(metrics.brightness) +
+                   FastFaceConfig::BEST_SHOT_WEIGHT_CONTRAST * contrast_score(metrics.contrast);
+    double weight = FastFaceConfig::BEST_SHOT_WEIGHT_SHARPNESS + FastFaceConfig::BEST_SHOT_WEIGHT_BRIGHTNESS +
+                    FastFaceConfig::BEST_SHOT_WEIGHT_CONTRAST;
+    if (has_pose) {
+        double pose_angle = std::max(std::abs(face.yaw), std::abs(face.pitch));
+        score += FastFaceConfig::BEST_SHOT_WEIGHT_POSE *
+                 std::max(0.0, 100.0 * (1.0 - pose_angle / FastFaceConfig::POSE_WARNING_THRESHOLD));
+        weight += FastFaceConfig::BEST_SHOT_WEIGHT_POSE;
+    }
+    return score / weight;
+}
+
+// 把轨迹（track_id 为0时为所有轨迹）的候选帧按评分从高到低移入输出队列
+static void finish_best_shots(FfSession& session, int track_id) {
+    std::vector<BestShot>& shots = session.best_shots;
+    auto finished = std::stable_partition(shots.begin(), shots.end(), [track_id](const BestShot& shot) {
+        return track_id != 0 && shot.track_id != track_id;
+    });
+    std::sort(finished, shots.end(), [](const BestShot& a, const BestShot& b) {
+        return a.track_id != b.track_id ? a.track_id < b.track_id : a.score > b.score;
+    });
+    session.ready_shots.insert(session.ready_shots.end(), finished, shots.end());
+    shots.erase(finished, shots.end());
+}
+
+// 清空最佳抓拍，所有图像槽位回到空闲状态
+static void reset_best_shots(FfSession& session) {
+    session.best_shots.clear();
+    session.ready_shots.clear();
+    session.free_shot_slots.clear();
+    for (int slot = (int)session.shot_storage.size() - 1; slot >= 0; --slot) session.free_shot_slots.push_back(slot);
+}
+
+// 为新的候选帧取得空闲槽位，槽位用尽时返回-1。
+// 输出队列中尚未取走的抓拍和其他轨迹的候选都不会被占用
+static int acquire_shot_slot(FfSession& session) {
+    if (session.free_shot_slots.empty()) return -1;
+    int slot = session.free_shot_slots.back();
+    session.free_shot_slots.pop_back();
+    return slot;
+}
+
+// 用本帧结果更新各轨迹的最佳帧候选，人脸图像复制到候选的槽位中
+static void update_best_shots(FfSession& session, const FrameView& frame) {
+    const int keep = session.params.best_shot_count;
+    if (keep <= 0) return;
+    
+    std::vector<BestShot>& shots = session.best_shots;
+    const cv::Rect frame_rect(0, 0, frame.gray.cols, frame.gray.rows);
+    for (size_t i = 0; i < session.results.size(); ++i) {
+        const FfFaceResult& face = session.results[i];
+        const cv::Rect roi = session.faces[i] & frame_rect;
+        if (roi.area() <= 0) continue;
+        // 与分析阶段的姿态估计条件一致：阶段启用、未被质量门限跳过且有关键点
+        const bool has_pose = (face.stages & FF_STAGE_POSE) && !(face.skipped_stages & FF_STAGE_POSE) &&
+                              !session.poses[i].landmarks.empty();
+        double score = best_shot_score(face, session.face_metrics[i], has_pose);
+        
+        // 该轨迹已保留 keep 帧或槽位用尽时只替换其中最差的一帧
+        BestShot* target = nullptr;
+        int count = 0;
+        for (BestShot& shot : shots) {
+            if (shot.track_id != face.track_id) continue;
+            ++count;
+            if (!target || shot.score < target->score) target = &shot;
+        }
+        int slot = count < keep ? acquire_shot_slot(session) : -1;
+        if (slot >= 0) {
+            shots.emplace_back();
+            target = &shots.back();
+            target->slot = slot;
+        } else if (!target || score <= target->score) {
+            // 槽位用尽时只能替换本轨迹最差的一帧，否则丢弃本帧
+            continue;
+        }
+        
+        target->track_id = face.track_id;
+        target->frame_index = session.frame_count - 1;
+        target->score = score;
+        target->face = face;
+        cv::Mat crop;
+        extract_color_roi(frame, roi, session.color_buffers[i], crop);
+        cv::Mat image = pooled_mat(session.shot_storage[target->slot], crop.rows, crop.cols, CV_8UC3);
+        crop.copyTo(image);
+        target->width = crop.cols;
+        target->height = crop.rows;
+    }
+}
+
+// 创建会话，每个会话加载独立的级联分类器
+static int create_session(const std::shared_ptr<const SharedModels>& models, std::unique_ptr<FfSession>& out_session) {
+    auto session = std::make_unique<FfSession>();
+    session->models = models;
+    
+    // 逐帧复用的缓冲区首帧按帧尺寸分配，此后只在帧尺寸变化时重新分配
+    cv::Mat* pooled[] = {
+        &session->features.gray_buffer, &session->features.sum_buffer, &session->features.sqsum_buffer,
+        &session->prev_gray, &session->detect_gray, &session->enhanced_gray, &session->motion.prev_small, &session->motion.small,
+        &session->motion.flow, &session->motion.flow_parts[0], &session->motion.flow_parts[1],
+        &session->motion.magnitude, &session->motion.prev_roi, &session->motion.roi, &session->mask_blob,
+        &session->mask_resized, &session->mask_scaled,
+    };
+    for (cv::Mat* mat : pooled) session->allocator.bind(*mat);
+    session->shot_storage.resize(FastFaceConfig::BEST_SHOT_POOL_SIZE);
+    for (cv::Mat& storage : session->shot_storage) session->allocator.bind(storage);
+    reset_best_shots(*session);
+    
+    session->params.detection_interval = FastFaceConfig::DETECTION_INTERVAL;
+    session->params.min_track_confidence = FastFaceConfig::MIN_TRACK_CONFIDENCE;
+    session->params.detection_scale = FastFaceConfig::DETECTION_SCALE;
+    session->params.detection_width = FastFaceConfig::DETECTION_WIDTH;
+    session->params.full_scan_period = FastFaceConfig::FULL_SCAN_PERIOD;
+    session->params.roi_expand_factor = FastFaceConfig::ROI_EXPAND_FACTOR;
+    session->params.focal_length_x = 0.0;
+    session->params.focal_length_y = 0.0;
+    session->params.principal_x = -1.0;
+    session->params.principal_y = -1.0;
+    session->params.landmark_tracking = FastFaceConfig::LANDMARK_TRACKING;
+    session->params.motion_estimator = FastFaceConfig::MOTION_ESTIMATOR;
+    session->params.mask_interval = FastFaceConfig::MASK_INTERVAL;
+    session->params.low_light_mode = FastFaceConfig::LOW_LIGHT_MODE;
+    session->params.gate_min_face_size = FastFaceConfig::GATE_MIN_FACE_SIZE;
+    session->params.gate_min_brightness_score = FastFaceConfig::GATE_MIN_BRIGHTNESS_SCORE;
+    session->params.gate_min_sharpness_score = FastFaceConfig::GATE_MIN_SHARPNESS_SCORE;
+    session->params.gated_stages = FastFaceConfig::GATED_STAGES;
+    session->params.best_shot_count = FastFaceConfig::BEST_SHOT_COUNT;
+    session->params.stages = models->stages;
+    
+    int detector_result = create_face_detector(*models, session->detector);
+    if (detector_result != FastFaceError::SUCCESS) return detector_result;
+    
+    if (!models->mask_model_path.empty() && (models->stages & FF_STAGE_MASK)) {
+        try {
+            session->mask_model = cv::dnn::readNet(models->mask_model_path);
+            session->mask_model.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+            session->mask_model.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+        } catch (const cv::Exception&) {
+            return FastFaceError::MASK_MODEL_LOAD_FAILED;
+        }
+        if (session->mask_model.empty()) return FastFaceError::MASK_MODEL_LOAD_FAILED;
+    }
+    
+    out_session = std::move(session);
+    return FastFaceError::SUCCESS;
+}
+
+// 清空会话的时序状态（无状态帧复用会话时使用）
+static void reset_session_state(FfSession& session) {
+    session.tracks.clear();
+    session.frame_count = 0;
+    reset_best_shots(session);
+    // 上一帧亮度平面的存储交还给转换缓冲区，下一帧不必重新分配
+    if (session.features.gray_buffer.empty()) std::swap(session.features.gray_buffer, session.prev_gray);
+    session.prev_gray.release();
+    session.faces.clear();
+    session.frames_since_detection = 0;
+    session.detections_since_full_scan = 0;
+    session.poses.clear();
+    session.prev_poses.clear();
+}
+
+// 实际使用的工作线程数
+static int resolve_worker_thread_count(int requested) {
+    if (requested > 0) return requested;
+    int hardware = (int)std::thread::hardware_concurrency();
+    return hardware > 0 ? hardware : 1;
+}
+
+// 根据当前许可证信息发布新快照，调用方需持有 g_mutex
+static void publish_license_snapshot(std::time_t expiry) {
+    auto snapshot = std::make_unique<LicenseSnapshot>();
+    snapshot->expiry = expiry;
+    snapshot->is_trial = g_license_info.is_trial;
+    snapshot->trial_end = g_license_info.trial_end;
+    snapshot->status = g_license_info.status;
+    snapshot->type = g_license_info.type;
+    snapshot->expires = g_license_info.expires;
+    g_license_snapshot.publish(std::move(snapshot));
+}
+
+// 检查许可证状态（无锁），成功时输出当前快照供本帧结果使用
+static int check_license(std::shared_ptr<const LicenseSnapshot>& license) {
+    std::shared_ptr<const LicenseSnapshot> snapshot = g_license_snapshot.load();
+    if (!snapshot) return FastFaceError::NOT_INITIALIZED;
+    
+    std::time_t now = std::time(nullptr);
+    if (now > snapshot->expiry) return FastFaceError::KEY_EXPIRED;
+    if (snapshot->is_trial && now > snapshot->trial_end) return FastFaceError::TRIAL_EXPIRED;
+    
+    license = snapshot;
+    return FastFaceError::SUCCESS;
+}
+
+// 取中位数（会打乱输入顺序）
+static float median_of(std::vector<float>& values) {
+    auto middle = values.begin() + values.size() / 2;
+    std::nth_element(values.begin(), middle, values.end());
+    return *middle;
+}
+
+// 用稀疏光流把 session.faces 从上一帧传播到当前帧
+// 返回所有人脸中最低的跟踪置信度（成功跟踪的特征点比例），无法跟踪时返回0
+static double track_faces(FfSession& session, const cv::Mat& gray) {
+    const cv::Mat& prev_gray = session.prev_gray;
+    if (prev_gray.empty() || prev_gray.size() != gray.size()) return 0.0;
+    
+    TrackBuffers& track = session.track;
+    const cv::Rect frame_rect(0, 0, gray.cols, gray.rows);
+    double min_confidence = 1.0;
+    
+    for (cv::Rect& face : session.faces) {
+        cv::Rect roi = face & frame_rect;
+        if (roi.area() <= 0) return 0.0;
+        
+        // 在上一帧人脸区域内选取角点
+        cv::goodFeaturesToTrack(prev_gray(roi), track.points, FastFaceConfig::TRACK_MAX_POINTS, 0.01, 3.0);
+        if ((int)track.points.size() < FastFaceConfig::TRACK_MIN_POINTS) return 0.0;
+        for (auto& point : track.points) {
+            point.x += roi.x;
+            point.y += roi.y;
+        }
+        
+        cv::calcOpticalFlowPyrLK(prev_gray, gray, track.points, track.next_points, track.status, track.errors,
+                                 cv::Size(15, 15), 2);
+        
+        // 用成功跟踪的点估计平移和尺度
+        cv::Point2f prev_center(0, 0), next_center(0, 0);
+        track.dx.clear();
+        track.dy.clear();
+        for (size_t i = 0; i < track.points.size(); ++i) {
+            if (!track.status[i]) continue;
+            track.dx.push_back(track.next_points[i].x - track.points[i].x);
+            track.dy.push_back(track.next_points[i].y - track.points[i].y);
+            prev_center += track.points[i];
+            next_center += track.next_points[i];
+        }
+        int tracked_count = (int)track.dx.size();
+        if (tracked_count < FastFaceConfig::TRACK_MIN_POINTS) return 0.0;
+        prev_center *= 1.0f / tracked_count;
+        next_center *= 1.0f / tracked_count;
+        
+        track.scale.clear();
+        for (size_t i = 0; i < track.points.size(); ++i) {
+            if (!track.status[i]) continue;
+            double prev_dist = cv::norm(track.points[i] - prev_center);
+            if (prev_dist > 1.0) track.scale.push_back((float)(cv::norm(track.next_points[i] - next_center) / prev_dist));
+        }
+        
+        float dx = median_of(track.dx);
+        float dy = median_of(track.dy);
+        float scale = track.scale.empty() ? 1.0f : median_of(track.scale);
+        
+        double cx = face.x + face.width * 0.5 + dx;
+        double cy = face.y + face.height * 0.5 + dy;
+        double width = face.width * scale;
+        double height = face.height * scale;
+        cv::Rect moved(cvRound(cx - width * 0.5), cvRound(cy - height * 0.5), cvRound(width), cvRound(height));
+        
+        // 人脸框大部分移出画面时视为跟踪失败
+        face = moved & frame_rect;
+        if (face.area() * 2 < moved.area()) return 0.0;
+        
+        min_confidence = std::min(min_confidence, tracked_count / (double)track.points.size());
+    }
+    
+    return min_confidence;
+}
+
+// 会话参数对应的检测缩放比例
+static double detection_scale(const FfSessionParams& params, int frame_width) {
+    if (params.detection_width > 0) return std::min(1.0, params.detection_width / (double)frame_width);
+    return params.detection_scale;
+}
+
+// 以上一次人脸位置为中心的局部检测窗口（检测图像坐标），相互重叠的窗口合并为一个
+static void build_detection_windows(const std::vector<cv::Rect>& faces, double scale, double expand_factor,
+                                    const cv::Size& image_size, std::vector<cv::Rect>& windows) {
+    const cv::Rect image_rect(0, 0, image_size.width, image_size.height);
+    windows.clear();
+    for (const cv::Rect& face : faces) {
+        double width = face.width * scale * expand_factor;
+        double height = face.height * scale * expand_factor;
+        double cx = (face.x + face.width * 0.5) * scale;
+        double cy = (face.y + face.height * 0.5) * scale;
+        cv::Rect window(cvRound(cx - width * 0.5), cvRound(cy - height * 0.5), cvRound(width), cvRound(height));
+        window &= image_rect;
+        if (window.area() > 0) windows.push_back(window);
+    }
+    
+    // 合并后窗口变大，可能与其他窗口产生新的重叠，重复直到稳定
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < windows.size() && !merged; ++i) {
+            for (size_t j = i + 1; j < windows.size(); ++j) {
+                if ((windows[i] & windows[j]).area() > 0) {
+                    windows[i] |= windows[j];
+                    windows.erase(windows.begin() + j);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// 人脸检测，结果写入 session.faces（原分辨率坐标）
+// 两次全画面检测之间只在已知人脸附近的窗口内检测
+// low_light 为真时先对（缩放后的）检测图像做低照度增强
+static void detect_faces(FfSession& session, const cv::Mat& gray, bool low_light) {
+    const FfSessionParams& params = session.params;
+    double scale = detection_scale(params, gray.cols);
+    
+    // 在缩小的图像上检测，最小人脸尺寸同比缩小
+    const cv::Mat* image = &gray;
+    if (scale < 1.0) {
+        cv::Size detect_size(std::max(1, cvRound(gray.cols * scale)), std::max(1, cvRound(gray.rows * scale)));
+        cv::resize(gray, session.detect_gray, detect_size, 0, 0, cv::INTER_AREA);
+        image = &session.detect_gray;
+    } else {
+        scale = 1.0;
+    }
+    if (low_light) {
+        enhance_low_light(session.clahe, *image, session.enhanced_gray);
+        image = &session.enhanced_gray;
+    }
+    int min_size = std::max(1, cvRound(FastFaceConfig::FACE_DETECTION_MIN_SIZE * scale));
+    
+    std::vector<cv::Rect>& detections = session.detections;
+    detections.clear();
+    
+    bool full_scan = session.faces.empty() || session.detections_since_full_scan + 1 >= params.full_scan_period;
+    if (!full_scan) {
+        build_detection_windows(session.faces, scale, params.roi_expand_factor, image->size(), session.windows);
+        for (const cv::Rect& window : session.windows) {
+            if (window.width < min_size || window.height < min_size) continue;
+            
+            // 纯色窗口（遮挡、黑屏）不可能包含人脸，只统计窗口本身后跳过；低照度帧原图对比度低，不做判断
+            const cv::Mat window_image = (*image)(window);
+            if (!low_light) {
+                cv::Scalar mean, stddev;
+                cv::meanStdDev(window_image, mean, stddev);
+                if (stddev[0] < FastFaceConfig::FLAT_WINDOW_STDDEV) continue;
+            }
+            session.detector->detect(window_image, min_size, session.window_faces);
+            for (cv::Rect face : session.window_faces) {
+                face.x += window.x;
+                face.y += window.y;
+                detections.push_back(face);
+            }
+        }
+        // 已知人脸全部丢失时回退到全画面检测
+        full_scan = detections.empty();
+    }
+    
+    if (full_scan) {
+        session.detector->detect(*image, min_size, detections);
+        session.detections_since_full_scan = 0;
+    } else {
+        ++session.detections_since_full_scan;
+    }
+    
+    // 人脸框映射回原分辨率
+    std::vector<cv::Rect>& faces = session.faces;
+    faces.clear();
+    if (scale >= 1.0) {
+        faces.assign(detections.begin(), detections.end());
+        return;
+    }
+    double inverse_x = gray.cols / (double)image->cols;
+    double inverse_y = gray.rows / (double)image->rows;
+    const cv::Rect frame_rect(0, 0, gray.cols, gray.rows);
+    for (const cv::Rect& face : detections) {
+        cv::Rect mapped(cvRound(face.x * inverse_x), cvRound(face.y * inverse_y),
+                        cvRound(face.width * inverse_x), cvRound(face.height * inverse_y));
+        faces.push_back(mapped & frame_rect);
+    }
+}
+
+// 把本帧人脸框关联到已有轨迹：满足IoU或中心距离门限的候选按中心距离从小到大贪心匹配，
+// 未关联的人脸新建轨迹，连续未关联超过 TRACK_MAX_MISSES 帧的轨迹删除；各人脸的槽位写入 session.face_slots
+static void update_tracks(FfSession& session) {
+    const std::vector<cv::Rect>& faces = session.faces;
+    TrackTable& tracks = session.tracks;
+    
+    // 先删除过期轨迹，本帧之后的槽位保持不变（从后向前删除，移入的槽位都已检查过）
+    // 轨迹结束时输出其最佳抓拍
+    for (int slot = tracks.size() - 1; slot >= 0; --slot) {
+        if (tracks.misses[slot] > FastFaceConfig::TRACK_MAX_MISSES) {
+            finish_best_shots(session, tracks.ids[slot]);
+            tracks.remove(slot);
+        }
+    }
+    
+    std::vector<TrackCandidate>& candidates = session.track_candidates;
+    candidates.clear();
+    for (int slot = 0; slot < tracks.size(); ++slot) {
+        const cv::Rect& box = tracks.boxes[slot];
+        double cx = box.x + box.width * 0.5;
+        double cy = box.y + box.height * 0.5;
+        for (size_t i = 0; i < faces.size(); ++i) {
+            const cv::Rect& face = faces[i];
+            double dx = face.x + face.width * 0.5 - cx;
+            double dy = face.y + face.height * 0.5 - cy;
+            double distance = std::sqrt(dx * dx + dy * dy) / std::max(1, box.width);
+            double overlap = (box & face).area();
+            double area_union = box.area() + face.area() - overlap;
+            double iou = area_union > 0 ? overlap / area_union : 0.0;
+            if (iou >= FastFaceConfig::TRACK_MATCH_IOU || distance <= FastFaceConfig::TRACK_MATCH_DISTANCE) {
+                candidates.push_back({distance, slot, (int)i});
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const TrackCandidate& a, const TrackCandidate& b) {
+        return a.distance < b.distance;
+    });
+    
+    std::vector<int>& face_slots = session.face_slots;
+    std::vector<unsigned char>& matched = session.track_matched;
+    face_slots.assign(faces.size(), -1);
+    matched.assign(tracks.size(), 0);
+    for (const TrackCandidate& candidate : candidates) {
+        if (matched[candidate.slot] || face_slots[candidate.face] >= 0) continue;
+        matched[candidate.slot] = 1;
+        face_slots[candidate.face] = candidate.slot;
+    }
+    for (int slot = 0; slot < (int)matched.size(); ++slot) {
+        if (!matched[slot]) ++tracks.misses[slot];
+    }
+    for (size_t i = 0; i < faces.size(); ++i) {
+        if (face_slots[i] >= 0) {
+            tracks.push(face_slots[i], faces[i]);
+        } else {
+            face_slots[i] = tracks.add(faces[i]);
+        }
+    }
+}
+
+// 用金字塔光流把上一帧的关键点传播到当前帧，误差或漂移过大时返回 false
+static bool track_landmarks(FfSession& session, const cv::Mat& gray, const FacePose& previous,
+                            const cv::Rect& face, std::vector<cv::Point2f>& landmarks) {
+    TrackBuffers& track = session.track;
+    cv::calcOpticalFlowPyrLK(session.prev_gray, gray, previous.landmarks, landmarks, track.status, track.errors,
+                             cv::Size(21, 21), 3);
+    
+    double total_error = 0.0;
+    cv::Point2f center(0, 0);
+    for (size_t i = 0; i < landmarks.size(); ++i) {
+        if (!track.status[i]) return false;
+        total_error += track.errors[i];
+        center += landmarks[i];
+    }
+    if (total_error / landmarks.size() > FastFaceConfig::LANDMARK_MAX_TRACK_ERROR) return false;
+    
+    // 关键点整体偏离人脸框说明跟踪已漂移
+    center *= 1.0f / landmarks.size();
+    double dx = center.x - (face.x + face.width * 0.5);
+    double dy = center.y - (face.y + face.height * 0.5);
+    return std::sqrt(dx * dx + dy * dy) <= FastFaceConfig::LANDMARK_MAX_DRIFT * face.width;
+}
+
+// 更新本帧各人脸的关键点：能跟踪的从上一帧传播，其余人脸标记为需要拟合，由逐人脸的并行阶段完成
+// 同时以上一帧同一人脸的姿态作为本帧 solvePnP 的初值
+static void update_face_landmarks(FfSession& session, const cv::Mat& gray) {
+    const std::vector<cv::Rect>& faces = session.faces;
+    std::swap(session.poses, session.prev_poses);
+    session.poses.resize(faces.size());
+    
+    const bool enabled = (session.params.stages & FF_STAGE_LANDMARKS) != 0;
+    bool can_track = enabled && session.params.landmark_tracking && !session.prev_gray.empty() &&
+                     session.prev_gray.size() == gray.size();
+    
+    for (size_t i = 0; i < faces.size(); ++i) {
+        FacePose& pose = session.poses[i];
+        pose.bbox = faces[i];
+        pose.valid = false;
+        pose.needs_fit = false;
+        pose.track_id = session.tracks.ids[session.face_slots[i]];
+        
+        const FacePose* previous = find_previous_pose(session.prev_poses, pose.track_id);
+        if (previous && previous->valid) {
+            pose.rotation = previous->rotation;
+            pose.translation = previous->translation;
+            pose.valid = true;
+        }
+        pose.mask_state = previous ? previous->mask_state : -1;
+        pose.mask_age = previous ? previous->mask_age : 0;
+        
+        // 会话未启用关键点或未通过质量门限的人脸不拟合关键点
+        if (!enabled || (session.results[i].skipped_stages & FF_STAGE_LANDMARKS)) {
+            pose.landmarks.clear();
+            pose.landmark_age = 0;
+            continue;
+        }
+        
+        if (can_track && previous && !previous->landmarks.empty() &&
+            previous->landmark_age + 1 < FastFaceConfig::LANDMARK_REFIT_INTERVAL &&
+            track_landmarks(session, gray, *previous, faces[i], pose.landmarks)) {
+            pose.landmark_age = previous->landmark_age + 1;
+            continue;
+        }
+        
+        pose.landmarks.clear();
+        pose.landmark_age = 0;
+        pose.needs_fit = true;
+    }
+}
+
+// 为单个人脸拟合关键点（LBF内部只使用灰度图，直接传入亮度平面）
+// 每次拟合从池中借出一个实例，同一帧的其他人脸和其他会话同时拟合时各用各的实例
+static void fit_face_landmarks(const SharedModels& models, const cv::Mat& gray, const cv::Rect& face,
+                               LandmarkFitBuffers& buffers, FacePose& pose) {
+    FacemarkLease facemark(models.facemarks);
+    if (!facemark.get()) return;
+    buffers.faces.assign(1, face);
+    buffers.landmarks.clear();
+    if (facemark.get()->fit(gray, buffers.faces, buffers.landmarks) && !buffers.landmarks.empty()) {
+        pose.landmarks.swap(buffers.landmarks[0]);
+    }
+}
+
+// 用分类网络判断各人脸是否佩戴口罩：间隔内的跟踪人脸沿用上次结果，其余人脸合并为一个批次做一次前向计算
+static void classify_masks(FfSession& session, const FrameView& frame) {
+    if (session.mask_model.empty() || !(session.params.stages & FF_STAGE_MASK)) return;
+    
+    std::vector<cv::Mat>& crops = session.mask_crops;
+    std::vector<int>& indices = session.mask_indices;
+    crops.clear();
+    indices.clear();
+    const cv::Rect frame_rect(0, 0, frame.gray.cols, frame.gray.rows);
+    for (size_t i = 0; i < session.poses.size(); ++i) {
+        FacePose& pose = session.poses[i];
+        if (session.results[i].skipped_stages & FF_STAGE_MASK) continue;
+        if (pose.mask_state >= 0 && pose.mask_age + 1 < session.params.mask_interval) {
+            ++pose.mask_age;
+            continue;
+        }
+        pose.mask_state = -1;
+        cv::Rect roi = session.faces[i] & frame_rect;
+        if (roi.area() <= 0) continue;
+        crops.emplace_back();
+        extract_color_roi(frame, roi, session.color_buffers[i], crops.back());
+        indices.push_back((int)i);
+    }
+    if (crops.empty()) return;
+    
+    // 分类失败时 mask_state 保持-1，本帧回退到颜色启发式
+    try {
+        // 与 blobFromImages(crops, 1/255, size, swapRB) 相同的NCHW批次，直接写入会话缓冲区
+        const int size = FastFaceConfig::MASK_MODEL_INPUT_SIZE;
+        const int count = (int)crops.size();
+        const size_t plane = (size_t)size * size;
+        pooled_mat(session.mask_blob, 1, (int)(count * 3 * plane), CV_32F);
+        const int dims[4] = {count, 3, size, size};
+        cv::Mat blob(4, dims, CV_32F, session.mask_blob.data);
+        cv::Mat resized = pooled_mat(session.mask_resized, size, size, CV_8UC3);
+        cv::Mat scaled = pooled_mat(session.mask_scaled, size, size, CV_32FC3);
+        const int bgr_to_rgb[] = {2, 0, 1, 1, 0, 2};
+        for (int k = 0; k < count; ++k) {
+            cv::resize(crops[k], resized, resized.size(), 0, 0, cv::INTER_LINEAR);
+            resized.convertTo(scaled, CV_32F, 1.0 / 255.0);
+            float* sample = blob.ptr<float>(k);
+            cv::Mat planes[3] = {cv::Mat(size, size, CV_32F, sample), cv::Mat(size, size, CV_32F, sample + plane),
+                                 cv::Mat(size, size, CV_32F, sample + 2 * plane)};
+            cv::mixChannels(&scaled, 1, planes, 3, bgr_to_rgb, 3);
+        }
+        session.mask_model.setInput(blob);
+        cv::Mat scores = session.mask_model.forward().reshape(1, count);
+        
+        const int mask_class = scores.cols == 1 ? 0 : FastFaceConfig::MASK_MODEL_MASK_CLASS;
+        if (mask_class >= scores.cols) return;
+        for (size_t k = 0; k < indices.size(); ++k) {
+            FacePose& pose = session.poses[indices[k]];
+            pose.mask_state = scores.at<float>((int)k, mask_class) >= FastFaceConfig::MASK_MODEL_THRESHOLD ? 1 : 0;
+            pose.mask_age = 0;
+        }
+    } catch (const cv::Exception&) {
+    }
+}
+
+// 稠密光流运动估计：逐个人脸在四周外扩 MOTION_ROI_MARGIN 的区域上计算，只取人脸框内的平均幅度
+// scale < 1 时先缩小该区域，结果换算回原分辨率像素；各缓冲区按最大区域只增不减
+static void farneback_motion(const cv::Mat& prev_gray, const cv::Mat& gray, const std::vector<cv::Rect>& faces,
+                             double scale, MotionBuffers& buffers, std::vector<double>& motion) {
+    scale = std::min(scale, 1.0);
+    const cv::Rect frame_rect(0, 0, gray.cols, gray.rows);
+    for (size_t i = 0; i < faces.size(); ++i) {
+        const cv::Rect face = faces[i] & frame_rect;
+        if (face.area() <= 0) continue;
+        int margin_x = cvRound(face.width * FastFaceConfig::MOTION_ROI_MARGIN);
+        int margin_y = cvRound(face.height * FastFaceConfig::MOTION_ROI_MARGIN);
+        const cv::Rect region = cv::Rect(face.x - margin_x, face.y - margin_y,
+                                         face.width + 2 * margin_x, face.height + 2 * margin_y) & frame_rect;
+        
+        cv::Mat prev = prev_gray(region);
+        cv::Mat current = gray(region);
+        if (scale < 1.0) {
+            int cols = std::max(1, cvRound(region.width * scale));
+            int rows = std::max(1, cvRound(region.height * scale));
+            cv::Mat prev_small = pooled_mat(buffers.prev_small, rows, cols, CV_8UC1);
+            cv::Mat small = pooled_mat(buffers.small, rows, cols, CV_8UC1);
+            cv::resize(prev, prev_small, prev_small.size(), 0, 0, cv::INTER_AREA);
+            cv::resize(current, small, small.size(), 0, 0, cv::INTER_AREA);
+            prev = prev_small;
+            current = small;
+        }
+        
+        cv::Mat flow = pooled_mat(buffers.flow, current.rows, current.cols, CV_32FC2);
+        cv::Mat flow_parts[2] = {pooled_mat(buffers.flow_parts[0], current.rows, current.cols, CV_32F),
+                                 pooled_mat(buffers.flow_parts[1], current.rows, current.cols, CV_32F)};
+        cv::Mat magnitude = pooled_mat(buffers.magnitude, current.rows, current.cols, CV_32F);
+        cv::calcOpticalFlowFarneback(prev, current, flow, 0.5, 3, 15, 3, 5, 1.2, 0);
+        cv::split(flow, flow_parts);
+        cv::magnitude(flow_parts[0], flow_parts[1], magnitude);
+        
+        // 人脸框在（缩小后）区域中的位置
+        double region_scale = current.cols / (double)region.width;
+        cv::Rect inner(cvRound((face.x - region.x) * region_scale), cvRound((face.y - region.y) * region_scale),
+                       std::max(1, cvRound(face.width * region_scale)), std::max(1, cvRound(face.height * region_scale)));
+        inner &= cv::Rect(0, 0, magnitude.cols, magnitude.rows);
+        if (inner.area() > 0) motion[i] = cv::mean(magnitude(inner))[0] / region_scale;
+    }
+}
+
+// 稀疏光流运动估计：所有人脸的网格点合并为一次光流计算
+static void sparse_lk_motion(FfSession& session, const cv::Mat& gray, std::vector<double>& motion) {
+    const std::vector<cv::Rect>& faces = session.faces;
+    TrackBuffers& track = session.track;
+    const int grid = FastFaceConfig::MOTION_GRID_POINTS;
+    
+    track.points.clear();
+    for (const cv::Rect& face : faces) {
+        for (int y = 0; y < grid; ++y) {
+            for (int x = 0; x < grid; ++x) {
+                track.points.push_back(cv::Point2f(face.x + (x + 0.5f) * face.width / grid,
+                                                   face.y + (y + 0.5f) * face.height / grid));
+            }
+        }
+    }
+    
+    cv::calcOpticalFlowPyrLK(session.prev_gray, gray, track.points, track.next_points, track.status, track.errors,
+                             cv::Size(15, 15), 2);
+    
+    const int points_per_face = grid * grid;
+    for (size_t i = 0; i < faces.size(); ++i) {
+        double total = 0.0;
+        int count = 0;
+        for (int k = 0; k < points_per_face; ++k) {
+            size_t p = i * points_per_face + k;
+            if (!track.status[p]) continue;
+            total += cv::norm(track.next_points[p] - track.points[p]);
+            ++count;
+        }
+        motion[i] = count > 0 ? total / count : 0.0;
+    }
+}
+
+// 相位相关运动估计：逐个人脸区域估计整体平移
+static void phase_correlation_motion(const cv::Mat& prev_gray, const cv::Mat& gray, const std::vector<cv::Rect>& faces,
+                                     MotionBuffers& buffers, std::vector<double>& motion) {
+    const cv::Rect frame_rect(0, 0, gray.cols, gray.rows);
+    for (size_t i = 0; i < faces.size(); ++i) {
+        cv::Rect roi = faces[i] & frame_rect;
+        if (roi.area() <= 0) continue;
+        cv::Mat prev_roi = pooled_mat(buffers.prev_roi, roi.height, roi.width, CV_32F);
+        cv::Mat current_roi = pooled_mat(buffers.roi, roi.height, roi.width, CV_32F);
+        prev_gray(roi).convertTo(prev_roi, CV_32F);
+        gray(roi).convertTo(current_roi, CV_32F);
+        cv::Point2d shift = cv::phaseCorrelate(prev_roi, current_roi);
+        motion[i] = std::sqrt(shift.x * shift.x + shift.y * shift.y);
+    }
+}
+
+// 估计各人脸区域的运动幅度（像素/帧），结果写入 session.face_motion
+static void estimate_face_motion(FfSession& session, const cv::Mat& gray) {
+    const std::vector<cv::Rect>& faces = session.faces;
+    std::vector<double>& motion = session.face_motion;
+    motion.assign(faces.size(), 0.0);
+    
+    const cv::Mat& prev_gray = session.prev_gray;
+    if (faces.empty() || prev_gray.empty() || prev_gray.size() != gray.size()) return;
+    
+    try {
+        switch (session.params.motion_estimator) {
+        case FF_MOTION_FARNEBACK_FULL:
+            farneback_motion(prev_gray, gray, faces, 1.0, session.motion, motion);
+            break;
+        case FF_MOTION_FARNEBACK_DOWNSCALED:
+            farneback_motion(prev_gray, gray, faces, FastFaceConfig::MOTION_DOWNSCALE, session.motion, motion);
+            break;
+        case FF_MOTION_PHASE_CORRELATION:
+            phase_correlation_motion(prev_gray, gray, faces, session.motion, motion);
+            break;
+        default:
+            sparse_lk_motion(session, gray, motion);
+            break;
+        }
+    } catch (...) {
+        std::fill(motion.begin(), motion.end(), 0.0);
+    }
+}
+
+// 在共享线程池上并行执行各人脸的任务，调用线程也参与执行；只有一个人脸或没有线程池时顺序执行
+// 工作线程上直接使用所属线程池，避免在工作线程上释放线程池的最后一个引用
+static void for_each_face(int count, const std::function<void(int)>& body) {
+    WorkerPool* pool = nullptr;
+    std::shared_ptr<WorkerPool> pool_ref;
+    if (count > 1) {
+        pool = WorkerPool::current();
+        if (!pool) {
+            pool_ref = std::atomic_load(&g_worker_pool);
+            pool = pool_ref.get();
+        }
+    }
+    if (pool) {
+        pool->parallel_for(count, body);
+    } else {
+        for (int i = 0; i < count; ++i) body(i);
+    }
+}
+
+// 在指定会话上分析一帧，结果写入 session.results，调用方需持有会话锁
+static void analyze_session_frame(FfSession& session, const FrameView& frame) {
+    const cv::Mat& gray = frame.gray;
+    const FfSessionParams& params = session.params;
+    const int stages = params.stages;
+    session.features.reset(gray);
+    ++session.frame_count;
+    
+    // 关键帧做完整检测，其余帧跟踪上一帧的人脸框
+    std::vector<cv::Rect>& faces = session.faces;
+    bool tracked = false;
+    if (session.frames_since_detection + 1 < params.detection_interval) {
+        tracked = track_faces(session, gray) >= params.min_track_confidence;
+    }
+    if (tracked) {
+        ++session.frames_since_detection;
+    } else {
+        detect_faces(session, gray, needs_low_light(params, gray));
+        session.frames_since_detection = 0;
+    }
+    
+    // 结果按检测顺序预先分配，并行阶段各人脸只写自己的槽位
+    std::vector<FfFaceResult>& results = session.results;
+    results.assign(faces.size(), FfFaceResult());
+    
+    // 关联轨迹并按各自轨迹的历史判断稳定性（有状态，按人脸顺序执行）
+    update_tracks(session);
+    const TrackTable& tracks = session.tracks;
+    for (size_t i = 0; i < faces.size(); ++i) {
+        int slot = session.face_slots[i];
+        results[i].track_id = tracks.ids[slot];
+        results[i].stages = stages;
+        if (stages & FF_STAGE_STABILITY) {
+            results[i].is_stable = is_face_stable(faces[i], tracks.history_of(slot), tracks.lengths[slot]) ? 1 : 0;
+        }
+    }
+    
+    // 人脸数增加时补充颜色转换存储（只增不减），并行阶段各人脸只使用自己下标的存储
+    while (session.color_buffers.size() < faces.size()) {
+        session.color_buffers.emplace_back();
+        session.allocator.bind(session.color_buffers.back().packed);
+        session.allocator.bind(session.color_buffers.back().bgr);
+    }
+    if (session.fit_buffers.size() < faces.size()) session.fit_buffers.resize(faces.size());
+    
+    // 先统计亮度和对比度（重叠人脸共享一张积分图），再由质量门限决定各人脸是否执行关键点、姿态和口罩阶段
+    // 质量指标只在输出、门限、口罩启发式或最佳抓拍用到时计算；门限未计算清晰度的人脸，
+    // 只在输出、最佳抓拍或灰度输入的口罩启发式需要时补算
+    const bool gated = params.gate_min_face_size > 0 || params.gate_min_brightness_score > 0.0 ||
+                       params.gate_min_sharpness_score > 0.0;
+    const bool need_metrics = (stages & (FF_STAGE_QUALITY | FF_STAGE_MASK)) || gated || params.best_shot_count > 0;
+    const bool need_sharpness = (stages & FF_STAGE_QUALITY) || params.best_shot_count > 0;
+    std::vector<FaceMetrics>& metrics = session.face_metrics;
+    metrics.assign(faces.size(), FaceMetrics());
+    if (need_metrics && !faces.empty()) {
+        session.features.prepare_stats(faces);
+        for_each_face((int)faces.size(), [&](int index) {
+            FaceMetrics& face_metrics = metrics[index];
+            face_metrics = measure_face_brightness(session.features, faces[index]);
+            if (gated) results[index].skipped_stages = gate_face_stages(params, frame, faces[index], face_metrics);
+            const bool mask_heuristic = (stages & FF_STAGE_MASK) && frame.format == FF_PIXEL_GRAY &&
+                                        !(results[index].skipped_stages & FF_STAGE_MASK);
+            if (!face_metrics.has_sharpness && (need_sharpness || mask_heuristic)) {
+                measure_face_sharpness(frame, faces[index], face_metrics);
+            }
+        });
+    }
+    
+    update_face_landmarks(session, gray);
+    classify_masks(session, frame);
+    if (stages & FF_STAGE_MOTION) {
+        estimate_face_motion(session, gray);
+    } else {
+        session.face_motion.assign(faces.size(), 0.0);
+    }
+    if (stages & FF_STAGE_POSE) update_camera_model(session.camera, params, gray.size());
+    
+    // 上一帧亮度平面只供框跟踪、关键点跟踪和运动估计使用，都不需要时不保留
+    const bool keep_prev = params.detection_interval > 1 || (stages & FF_STAGE_MOTION) ||
+                           (params.landmark_tracking && (stages & FF_STAGE_LANDMARKS));
+    if (!keep_prev) {
+        if (session.features.gray_buffer.empty()) std::swap(session.features.gray_buffer, session.prev_gray);
+        session.prev_gray.release();
+    } else if (gray.data == session.features.gray_buffer.data) {
+        // 亮度平面位于会话缓冲区时与上一帧交换，引用调用方数据时才复制
+        std::swap(session.prev_gray, session.features.gray_buffer);
+    } else {
+        gray.copyTo(session.prev_gray);
+    }
+    
+    // 单个人脸的关键点拟合、口罩检测和姿态估计，各人脸之间相互独立
+    for_each_face((int)faces.size(), [&](int index) {
+        const cv::Rect& face_rect = faces[index];
+        const FaceMetrics& face_metrics = metrics[index];
+        FacePose& pose = session.poses[index];
+        FfFaceResult& face_result = results[index];
+        const int skipped = face_result.skipped_stages;
+        
+        if (pose.needs_fit) fit_face_landmarks(*session.models, gray, face_rect, session.fit_buffers[index], pose);
+        
+        // 分类网络已给出口罩结果时直接使用，否则使用颜色启发式
+        int has_mask = 0;
+        if ((stages & FF_STAGE_MASK) && !(skipped & FF_STAGE_MASK)) {
+            has_mask = pose.mask_state >= 0
+                ? pose.mask_state
+                : (detect_mask_by_color(frame, face_rect, face_metrics, session.color_buffers[index]) ? 1 : 0);
+        }
+        
+        // 头部姿态估计（简化版），以上一帧同一人脸的姿态为初值
+        double yaw = 0.0, pitch = 0.0, roll = 0.0;
+        if ((stages & FF_STAGE_POSE) && !(skipped & FF_STAGE_POSE) && !pose.landmarks.empty()) {
+            std::tie(yaw, pitch, roll) = estimate_pose(pose.landmarks, session.camera, pose);
+        }
+        
+        // 构建人脸结果
+        face_result.bbox = {face_rect.x, face_rect.y, face_rect.width, face_rect.height};
+        face_result.yaw = yaw;
+        face_result.pitch = pitch;
+        face_result.roll = roll;
+        face_result.has_mask = has_mask;
+        if (stages & FF_STAGE_QUALITY) {
+            face_result.sharpness = face_metrics.sharpness;
+            face_result.brightness = face_metrics.brightness;
+            face_result.distance = face_metrics.distance;
+            face_result.sharpness_score = sharpness_score(face_metrics.sharpness);
+            face_result.brightness_score = brightness_score(face_metrics.brightness);
+            face_result.contrast_score = contrast_score(face_metrics.contrast);
+        }
+        face_result.motion_blur = session.face_motion[index];
+        face_result.is_tracked = tracked ? 1 : 0;
+    });
+    
+    update_best_shots(session, frame);
+}
+
+// 直接写入调用方缓冲区的JSON输出器，不构建DOM、不分配内存
+// 缓冲区不足时停止写入，但继续统计完整输出所需的长度
+class JsonWriter {
+public:
+    JsonWriter(char* buffer, int capacity)
+        : buffer_(buffer), capacity_(buffer ? std::max(0, capacity) : 0) {}
+    
+    void begin_object() { separator(); put('{'); push(); }
+    void end_object() { pop(); put('}'); }
+    void begin_array() { separator(); put('['); push(); }
+    void end_array() { pop(); put(']'); }
+    
+    // 写入键名，后面紧跟一个值
+    void key(const char* name) {
+        separator();
+        write_string(name);
+        put(':');
+        after_key_ = true;
+    }
+    
+    void value(int v) {
+        separator();
+        char tmp[16];
+        int len = 0;
+        unsigned int magnitude = v < 0 ? 0u - (unsigned int)v : (unsigned int)v;
+        do {
+            tmp[len++] = (char)('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude > 0);
+        if (v < 0) put('-');
+        while (len > 0) put(tmp[--len]);
+    }
+    
+    // 定点小数，不受locale影响
+    void value(double v) {
+        separator();
+        if (!std::isfinite(v) || std::fabs(v) >= 1e15) {
+            write_raw("null");
+            return;
+        }
+        long long scale = 1;
+        for (int i = 0; i < FastFaceConfig::JSON_FLOAT_PRECISION; ++i) scale *= 10;
+        long long scaled = std::llround(v * (double)scale);
+        if (scaled < 0) {
+            put('-');
+            scaled = -scaled;
+        }
+        
+        char tmp[24];
+        int len = 0;
+        long long integer = scaled / scale;
+        do {
+            tmp[len++] = (char)('0' + integer % 10);
+            integer /= 10;
+        } while (integer > 0);
+        while (len > 0) put(tmp[--len]);
+        
+        if (FastFaceConfig::JSON_FLOAT_PRECISION > 0) {
+            put('.');
+            long long fraction = scaled % scale;
+            for (long long divisor = scale / 10; divisor > 0; divisor /= 10) {
+                put((char)('0' + (fraction / divisor) % 10));
+            }
+        }
+    }
+    
+    void value(bool v) { separator(); write_raw(v ? "true" : "false"); }
+    void value(const std::string& v) { separator(); write_string(v.c_str()); }
+    void value(const char* v) { separator(); write_string(v); }
+    
+    // 以NUL结尾；缓冲区不足时输出空字符串
+    bool finish() {
+        if (length_ < capacity_) {
+            buffer_[length_] = '\0';
+            return true;
+        }
+        if (capacity_ > 0) buffer_[0] = '\0';
+        return false;
+    }
+    
+    // 完整输出所需的缓冲区长度（含结尾NUL）
+    int required_size() const { return length_ + 1; }
+    
+private:
+    static constexpr int MAX_DEPTH = 8;
+    
+    void put(char c) {
+        if (length_ < capacity_) buffer_[length_] = c;
+        ++length_;
+    }
+    
+    void write_raw(const char* text) {
+        while (*text) put(*text++);
+    }
+    
+    void write_string(const char* text) {
+        static const char* hex = "0123456789abcdef";
+        put('"');
+        for (; *text; ++text) {
+            unsigned char c = (unsigned char)*text;
+            if (c == '"' || c == '\\') {
+                put('\\');
+                put((char)c);
+            } else if (c < 0x20) {
+                write_raw("\\u00");
+                put(hex[c >> 4]);
+                put(hex[c & 0xF]);
+            } else {
+                put((char)c);
+            }
+        }
+        put('"');
+    }
+    
+    // 同一层级的元素之间写逗号
+    void separator() {
+        if (after_key_) {
+            after_key_ = false;
+            return;
+        }
+        if (depth_ > 0 && depth_ <= MAX_DEPTH) {
+            if (has_element_[depth_ - 1]) put(',');
+            has_element_[depth_ - 1] = true;
+        }
+    }
+    
+    void push() {
+        if (depth_ < MAX_DEPTH) has_element_[depth_] = false;
+        ++depth_;
+    }
+    
+    void pop() { --depth_; }
+    
+    char* buffer_;
+    int capacity_;
+    int length_ = 0;
+    int depth_ = 0;
+    bool has_element_[MAX_DEPTH] = {};
+    bool after_key_ = false;
+};
+
+// 将分析结果格式化为JSON，required_size 可为空
+static int format_result_json(const FfFaceResult* faces, int face_count, const LicenseSnapshot& license,
+                              char* result_json, int json_buf_len, int* required_size) {
+    JsonWriter json(result_json, json_buf_len);
+    json.begin_object();
+    json.key("code"); json.value(FastFaceError::SUCCESS);
+    json.key("msg"); json.value("success");
+    
+    // 添加许可证信息
+    json.key("license_info");
+    json.begin_object();
+    json.key("status"); json.value(license.status);
+    json.key("expires"); json.value(license.expires);
+    json.key("type"); json.value(license.type);
+    if (license.is_trial) {
+        std::time_t now = std::time(nullptr);
+        int remaining_days = (license.trial_end - now) / (24 * 3600);
+        json.key("trial_remaining_days"); json.value(std::max(0, remaining_days));
+    }
+    json.end_object();
+    
+    json.key("faces");
+    json.begin_array();
+    for (int i = 0; i < face_count; ++i) {
+        const FfFaceResult& face = faces[i];
+        json.begin_object();
+        
+        json.key("bbox");
+        json.begin_object();
+        json.key("x"); json.value(face.bbox.x);
+        json.key("y"); json.value(face.bbox.y);
+        json.key("width"); json.value(face.bbox.width);
+        json.key("height"); json.value(face.bbox.height);
+        json.end_object();
+        json.key("track_id"); json.value(face.track_id);
+        json.key("source"); json.value(face.is_tracked ? "tracked" : "detected");
+        if (face.skipped_stages) {
+            // 未通过质量门限而跳过的阶段，对应字段为0
+            json.key("skipped_stages");
+            json.begin_array();
+            if (face.skipped_stages & FF_STAGE_LANDMARKS) json.value("landmarks");
+            if (face.skipped_stages & FF_STAGE_POSE) json.value("pose");
+            if (face.skipped_stages & FF_STAGE_MASK) json.value("mask");
+            json.end_array();
+        }
+        
+        // 会话未启用的阶段不输出对应字段
+        const int stages = face.stages;
+        if (stages & FF_STAGE_POSE) {
+            json.key("pose");
+            json.begin_object();
+            json.key("yaw"); json.value(face.yaw);
+            json.key("pitch"); json.value(face.pitch);
+            json.key("roll"); json.value(face.roll);
+            json.end_object();
+        }
+        
+        if (stages & (FF_STAGE_QUALITY | FF_STAGE_MASK)) {
+            json.key("metrics");
+            json.begin_object();
+            if (stages & FF_STAGE_QUALITY) {
+                json.key("sharpness"); json.value(face.sharpness);
+                json.key("brightness"); json.value(face.brightness);
+            }
+            if (stages & FF_STAGE_MASK) {
+                json.key("has_mask"); json.value(face.has_mask != 0);
+            }
+            if (stages & FF_STAGE_QUALITY) {
+                json.key("distance"); json.value(face.distance);
+            }
+            json.end_object();
+        }
+        
+        if (stages & FF_STAGE_QUALITY) {
+            json.key("quality_scores");
+            json.begin_object();
+            json.key("sharpness_score"); json.value(face.sharpness_score);
+            json.key("brightness_score"); json.value(face.brightness_score);
+            json.key("contrast_score"); json.value(face.contrast_score);
+            json.end_object();
+        }
+        
+        if (stages & (FF_STAGE_STABILITY | FF_STAGE_MOTION)) {
+            json.key("stability");
+            json.begin_object();
+            if (stages & FF_STAGE_STABILITY) {
+                json.key("is_stable"); json.value(face.is_stable != 0);
+            }
+            if (stages & FF_STAGE_MOTION) {
+                json.key("motion_blur"); json.value(face.motion_blur);
+            }
+            json.end_object();
+        }
+        
+        json.end_object();
+    }
+    json.end_array();
+    json.end_object();
+    
+    if (required_size) *required_size = json.required_size();
+    return json.finish() ? FastFaceError::SUCCESS : FastFaceError::BUFFER_TOO_SMALL;
+}
+
+// 将分析结果复制到调用方的结构体数组
+static int copy_face_results(const std::vector<FfFaceResult>& results, FfFaceResult* faces, int max_faces, int* face_count) {
+    int count = (int)results.size();
+    *face_count = count;
+    if (count > 0) {
+        std::copy(results.begin(), results.begin() + std::min(count, max_faces), faces);
+    }
+    return count > max_faces ? FastFaceError::BUFFER_TOO_SMALL : FastFaceError::SUCCESS;
+}
+
+// 描述紧密排列的BGR图像
+static FfImage make_bgr_image(const unsigned char* bgr_data, int width, int height) {
+    FfImage image = {};
+    image.format = FF_PIXEL_BGR;
+    image.width = width;
+    image.height = height;
+    image.planes[0] = bgr_data;
+    return image;
+}
+
+// 批量/异步帧描述对应的图像
+static FfImage frame_desc_image(const FfFrameDesc& desc) {
+    return desc.image ? *desc.image : make_bgr_image(desc.bgr_data, desc.width, desc.height);
 }
 
-// 检测运动模糊
-double detect_motion_blur(const cv::Mat& current_gray, const cv::Mat& prev_gray) {
-    if (prev_gray.empty()) return 0.0;
+// 复制图像的各个平面，输出的图像描述引用复制后的数据
+static int copy_image(const FfImage& src, cv::Mat owned[3], FfImage& dst) {
+    cv::Mat planes[3];
+    int result = get_image_planes(src, planes);
+    if (result != FastFaceError::SUCCESS) return result;
     
+    dst = FfImage();
+    dst.format = src.format;
+    dst.width = src.width;
+    dst.height = src.height;
+    for (int i = 0; i < 3; ++i) {
+        if (planes[i].empty()) continue;
+        planes[i].copyTo(owned[i]);
+        dst.planes[i] = owned[i].data;
+        dst.strides[i] = (int)owned[i].step;
+    }
+    return FastFaceError::SUCCESS;
+}
+
+// 分析一帧图像，结果写入 session.results，调用方需持有会话锁
+static int analyze_session_image(FfSession& session, const FfImage& image) {
     try {
-        cv::Mat flow;
-        cv::calcOpticalFlowFarneback(prev_gray, current_gray, flow, 0.5, 3, 15, 3, 5, 1.2, 0);
-        
-        std::vector<cv::Mat> flow_parts;
-        cv::split(flow, flow_parts);
-        cv::Mat magnitude, angle;
-        cv::cartToPolar(flow_parts[0], flow_parts[1], magnitude, angle);
+        FrameView frame;
+        int view_result = make_frame_view(image, session.features.gray_buffer, frame);
+        if (view_result != FastFaceError::SUCCESS) return view_result;
         
-        return cv::mean(magnitude)[0];
+        analyze_session_frame(session, frame);
+        return FastFaceError::SUCCESS;
     } catch (...) {
-        return 0.0;
+        return FastFaceError::ANALYSIS_EXCEPTION;
     }
 }
 
-// 增强人脸亮度
-cv::Mat enhance_face_brightness(const cv::Mat& face_roi, double gamma = 1.5) {
-    cv::Mat lab, enhanced;
-    cv::cvtColor(face_roi, lab, cv::COLOR_BGR2LAB);
-    
-    std::vector<cv::Mat> lab_planes(3);
-    cv::split(lab, lab_planes);
-    
-    // 应用CLAHE
-    cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(3.0, cv::Size(8, 8));
-    clahe->apply(lab_planes[0], lab_planes[0]);
-    
-    // 应用gamma校正
-    cv::Mat l_gamma;
-    lab_planes[0].convertTo(l_gamma, CV_64F);
-    l_gamma = cv::pow(l_gamma / 255.0, 1.0 / gamma) * 255;
-    l_gamma.convertTo(lab_planes[0], CV_8U);
+// 加锁分析一帧图像并输出JSON；缓冲区不足时结果仍保留在会话中，可只重新格式化
+static int run_session_analysis(FfSession& session, const FfImage& image, const LicenseSnapshot& license,
+                                char* result_json, int json_buf_len, int* required_size) {
+    std::lock_guard<std::mutex> lock(session.mutex);
+    int result = analyze_session_image(session, image);
+    if (result != FastFaceError::SUCCESS) return result;
     
-    cv::merge(lab_planes, lab);
-    cv::cvtColor(lab, enhanced, cv::COLOR_LAB2BGR);
-    return enhanced;
+    return format_result_json(session.results.data(), (int)session.results.size(), license,
+                              result_json, json_buf_len, required_size);
 }
 
-// 估计头部姿态
-std::tuple<double, double, double> estimate_pose(const std::vector<cv::Point2f>& landmarks, const cv::Size& frame_shape) {
+// 把会话的最近结果格式化为字符串：先只统计所需长度，再按该长度写入一次，调用方需持有会话锁
+static void format_session_json(const FfSession& session, const LicenseSnapshot& license, std::string& out) {
+    int required_size = 0;
+    format_result_json(session.results.data(), (int)session.results.size(), license, nullptr, 0, &required_size);
+    out.resize(required_size);
+    format_result_json(session.results.data(), (int)session.results.size(), license,
+                       &out[0], (int)out.size(), nullptr);
+    out.resize(required_size - 1);
+}
+
+// 取出一个空闲会话，没有则新建
+static int acquire_idle_session(std::unique_ptr<FfSession>& out_session) {
+    std::shared_ptr<const SharedModels> models;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (!g_idle_sessions.empty()) {
+            out_session = std::move(g_idle_sessions.back());
+            g_idle_sessions.pop_back();
+            return FastFaceError::SUCCESS;
+        }
+        if (!g_models) return FastFaceError::NOT_INITIALIZED;
+        models = g_models;
+    }
+    
     try {
-        // 简化的头部姿态估计，使用眼睛和鼻子关键点
-        if (landmarks.size() < 6) return {0.0, 0.0, 0.0};
-        
-        // 3D模型点（简化的人脸模型）
-        std::vector<cv::Point3f> model_points = {
-            cv::Point3f(0.0f, 0.0f, 0.0f),           // 鼻子
-            cv::Point3f(0.0f, -330.0f, -65.0f),      // 下巴
-            cv::Point3f(-165.0f, 170.0f, -135.0f),   // 左眼
-            cv::Point3f(165.0f, 170.0f, -135.0f),    // 右眼
-            cv::Point3f(-150.0f, -150.0f, -125.0f),  // 左嘴角
-            cv::Point3f(150.0f, -150.0f, -125.0f)    // 右嘴角
-        };
-        
-        // 2D图像点
-        std::vector<cv::Point2f> image_points = {
-            landmarks[0], landmarks[1], landmarks[2],
-            landmarks[3], landmarks[4], landmarks[5]
-        };
-        
-        // 相机内参
-        double focal_length = frame_shape.width;
-        cv::Point2d center(frame_shape.width / 2, frame_shape.height / 2);
-        cv::Mat camera_matrix = (cv::Mat_<double>(3, 3) << 
-            focal_length, 0, center.x,
-            0, focal_length, center.y,
-            0, 0, 1);
-        
-        cv::Mat dist_coeffs = cv::Mat::zeros(4, 1, CV_64F);
-        cv::Mat rotation_vector, translation_vector;
-        
-        cv::solvePnP(model_points, image_points, camera_matrix, dist_coeffs, 
-                    rotation_vector, translation_vector);
-        
-        // 转换为欧拉角
-        cv::Mat rotation_matrix;
-        cv::Rodrigues(rotation_vector, rotation_matrix);
-        
-        // 简化的欧拉角计算
-        double yaw = atan2(rotation_matrix.at<double>(2, 1), rotation_matrix.at<double>(2, 2)) * 180.0 / CV_PI;
-        double pitch = atan2(-rotation_matrix.at<double>(2, 0), 
-                           sqrt(rotation_matrix.at<double>(2, 1) * rotation_matrix.at<double>(2, 1) + 
-                                rotation_matrix.at<double>(2, 2) * rotation_matrix.at<double>(2, 2))) * 180.0 / CV_PI;
-        double roll = atan2(rotation_matrix.at<double>(1, 0), rotation_matrix.at<double>(0, 0)) * 180.0 / CV_PI;
-        
-        return {yaw, pitch, roll};
+        return create_session(models, out_session);
     } catch (...) {
-        return {0.0, 0.0, 0.0};
+        return FastFaceError::INIT_EXCEPTION;
     }
 }
 
-// 分析人脸特征
-struct FaceMetrics {
-    double sharpness;
-    double brightness;
-    bool has_mask;
-    double distance;
-};
+static void release_idle_session(std::unique_ptr<FfSession> session) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    // SDK已释放或重新初始化时直接丢弃
+    if (g_activated && session->models == g_models) {
+        g_idle_sessions.push_back(std::move(session));
+    }
+}
 
-FaceMetrics analyze_face(const cv::Mat& frame, const cv::Rect& face_roi) {
-    FaceMetrics metrics;
-    
-    // 提取人脸区域
-    cv::Mat face_img = frame(face_roi);
-    
-    // 计算清晰度
-    metrics.sharpness = calculate_sharpness(face_img);
-    
-    // 计算亮度
-    cv::Mat gray;
-    cv::cvtColor(face_img, gray, cv::COLOR_BGR2GRAY);
-    metrics.brightness = cv::mean(gray)[0];
+// 获取视频流对应的会话，不存在则创建
+static int acquire_stream_session(int stream_id, std::shared_ptr<FfSession>& out_session) {
+    std::shared_ptr<const SharedModels> models;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (!g_activated) return FastFaceError::NOT_INITIALIZED;
+        auto it = g_stream_sessions.find(stream_id);
+        if (it != g_stream_sessions.end()) {
+            out_session = it->second;
+            return FastFaceError::SUCCESS;
+        }
+        models = g_models;
+    }
     
-    // 简化的口罩检测（基于颜色和形状）
-    metrics.has_mask = false;
+    // 加载级联分类器较慢，不在全局锁内进行
+    std::unique_ptr<FfSession> session;
     try {
-        cv::Mat hsv;
-        cv::cvtColor(face_img, hsv, cv::COLOR_BGR2HSV);
-        
-        // 检测蓝色口罩（HSV范围）
-        cv::Mat blue_mask;
-        cv::inRange(hsv, cv::Scalar(100, 50, 50), cv::Scalar(130, 255, 255), blue_mask);
-        
-        // 检测白色口罩
-        cv::Mat white_mask;
-        cv::inRange(hsv, cv::Scalar(0, 0, 200), cv::Scalar(180, 30, 255), white_mask);
-        
-        double blue_ratio = cv::countNonZero(blue_mask) / (double)(blue_mask.rows * blue_mask.cols);
-        double white_ratio = cv::countNonZero(white_mask) / (double)(white_mask.rows * white_mask.cols);
-        
-        metrics.has_mask = (blue_ratio > FastFaceConfig::BLUE_MASK_RATIO_THRESHOLD || 
-                           white_ratio > FastFaceConfig::WHITE_MASK_RATIO_THRESHOLD);
+        int result = create_session(models, session);
+        if (result != FastFaceError::SUCCESS) return result;
     } catch (...) {
-        metrics.has_mask = false;
+        return FastFaceError::INIT_EXCEPTION;
     }
     
-    // 简化的距离估计
-    metrics.distance = FastFaceConfig::DEFAULT_DISTANCE_CM;
-    
-    return metrics;
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (!g_activated) return FastFaceError::NOT_INITIALIZED;
+    auto inserted = g_stream_sessions.emplace(stream_id, std::shared_ptr<FfSession>(std::move(session)));
+    out_session = inserted.first->second;
+    return FastFaceError::SUCCESS;
 }
 
-// 判断人脸是否稳定
-bool is_face_stable(const cv::Rect& current_bbox, const std::deque<cv::Rect>& history) {
-    if (history.size() < FastFaceConfig::STABLE_FRAMES_THRESHOLD) return false;
+// 分析一个异步任务并投递结果
+static void process_async_job(AsyncJob& job) {
+    AsyncCompletion completion;
+    completion.ticket = job.ticket;
+    completion.stream_id = job.stream_id;
     
-    double total_movement = 0.0;
-    for (const auto& prev_bbox : history) {
-        double dx = abs(current_bbox.x - prev_bbox.x) / (double)current_bbox.width;
-        double dy = abs(current_bbox.y - prev_bbox.y) / (double)current_bbox.height;
-        total_movement += dx + dy;
+    std::shared_ptr<const LicenseSnapshot> license;
+    completion.status = g_activated ? check_license(license) : FastFaceError::NOT_INITIALIZED;
+    if (completion.status == FastFaceError::SUCCESS) {
+        std::shared_ptr<FfSession> stream_session;
+        std::unique_ptr<FfSession> idle_session;
+        completion.status = job.stream_id < 0 ? acquire_idle_session(idle_session)
+                                              : acquire_stream_session(job.stream_id, stream_session);
+        
+        if (completion.status == FastFaceError::SUCCESS) {
+            FfSession* session = job.stream_id < 0 ? idle_session.get() : stream_session.get();
+            if (idle_session) reset_session_state(*session);
+            
+            std::lock_guard<std::mutex> lock(session->mutex);
+            completion.status = analyze_session_image(*session, job.image);
+            if (completion.status == FastFaceError::SUCCESS) format_session_json(*session, *license, completion.result_json);
+        }
+        if (idle_session) release_idle_session(std::move(idle_session));
     }
+    for (auto& plane : job.planes) plane.release();
     
-    return (total_movement / history.size()) < FastFaceConfig::STABILITY_THRESHOLD;
-}
-
-// 评分函数
-double sharpness_score(double sharpness_value) {
-    return std::min(100.0, std::max(0.0, sharpness_value / 10.0));
-}
-
-double brightness_score(double brightness_value) {
-    if (brightness_value < FastFaceConfig::BRIGHTNESS_MIN) return 0.0;
-    if (brightness_value > FastFaceConfig::BRIGHTNESS_MAX) return 0.0;
-    return 100.0 - abs(brightness_value - FastFaceConfig::BRIGHTNESS_OPTIMAL) / FastFaceConfig::BRIGHTNESS_OPTIMAL * 100.0;
+    if (job.callback) {
+        job.callback(completion.ticket, completion.stream_id, completion.status,
+                     completion.result_json.c_str(), job.user_data);
+        --g_in_flight;
+    } else {
+        std::lock_guard<std::mutex> lock(g_async_mutex);
+        g_completions.push_back(std::move(completion));
+        g_completion_cv.notify_all();
+    }
 }
 
-double contrast_score(const cv::Mat& gray_image) {
-    cv::Scalar mean, stddev;
-    cv::meanStdDev(gray_image, mean, stddev);
-    double std_val = stddev.val[0];
-    
-    if (std_val < 20) return 0.0;
-    if (std_val > 100) return 100.0;
-    return (std_val - 20) / 80.0 * 100.0;
+// 依次处理某一路视频流的待处理任务，队列为空时退出
+static void drain_stream_strand(int stream_id) {
+    for (;;) {
+        AsyncJob job;
+        {
+            std::lock_guard<std::mutex> lock(g_async_mutex);
+            StreamStrand& strand = g_strands[stream_id];
+            if (strand.pending.empty()) {
+                g_strands.erase(stream_id);
+                return;
+            }
+            job = std::move(strand.pending.front());
+            strand.pending.pop_front();
+        }
+        process_async_job(job);
+    }
 }
 
 extern "C" {
@@ -344,11 +2605,53 @@ int get_license_info(char* license_info, int info_buf_len) {
     return FastFaceError::SUCCESS;
 }
 
+// 默认LBP级联文件：优先使用随SDK安装到模型目录的文件，其次是OpenCV安装目录中与 haarcascades 并列的 lbpcascades；
+// 都不存在时返回模型目录中的路径，加载失败由调用方报告
+static std::string default_lbp_cascade_path() {
+    const std::string candidates[] = {
+        std::string(FAST_FACE_MODEL_DIR) + "/" + FastFaceConfig::LBP_CASCADE_FILE,
+        cv::data::haarcascades + "../lbpcascades/" + FastFaceConfig::LBP_CASCADE_FILE,
+    };
+    for (const std::string& path : candidates) {
+        if (std::ifstream(path).good()) return path;
+    }
+    return candidates[0];
+}
+
 int sdk_init(const char* license_key) {
+    return sdk_init_ex(license_key, nullptr);
+}
+
+int sdk_init_ex(const char* license_key, const FfInitOptions* options) {
+    // 重新初始化会替换正在使用的会话，在工作线程上调用可能替换调用方自身所在的会话
+    if (WorkerPool::current()) return FastFaceError::CALLED_FROM_WORKER;
+    
     std::lock_guard<std::mutex> lock(g_mutex);
     
     if (!license_key) return FastFaceError::INVALID_PARAMETERS;
     
+    // 初始化选项，未指定的字段使用默认值
+    int backend = options ? options->detector_backend : FastFaceConfig::DETECTOR_BACKEND;
+    if (backend != FF_DETECTOR_HAAR && backend != FF_DETECTOR_YUNET && backend != FF_DETECTOR_LBP) {
+        return FastFaceError::INVALID_PARAMETERS;
+    }
+    std::string model_path;
+    if (options && options->detector_model_path) {
+        model_path = options->detector_model_path;
+    } else if (backend == FF_DETECTOR_LBP) {
+        model_path = default_lbp_cascade_path();
+    } else {
+        model_path = std::string(FAST_FACE_MODEL_DIR) + "/" + FastFaceConfig::YUNET_MODEL_FILE;
+    }
+    cv::Size input_size(FastFaceConfig::YUNET_INPUT_WIDTH, FastFaceConfig::YUNET_INPUT_HEIGHT);
+    if (options && options->detector_input_width > 0) input_size.width = options->detector_input_width;
+    if (options && options->detector_input_height > 0) input_size.height = options->detector_input_height;
+    std::string mask_model_path = options && options->mask_model_path ? options->mask_model_path
+                                                                      : FastFaceConfig::MASK_MODEL_PATH;
+    int stages = options && options->stages ? options->stages : FastFaceConfig::DEFAULT_STAGES;
+    if (stages & ~FF_STAGE_ALL) return FastFaceError::INVALID_PARAMETERS;
+    if (stages & FF_STAGE_POSE) stages |= FF_STAGE_LANDMARKS;    // 姿态依赖关键点
+    
     std::string key(license_key);
     
     // 验证密钥
@@ -363,21 +2666,29 @@ int sdk_init(const char* license_key) {
     }
     
     try {
-        // 加载OpenCV人脸检测模型
-        if (!g_face_cascade.load(cv::data::haarcascades + "haarcascade_frontalface_alt2.xml")) {
-            return FastFaceError::FACE_CASCADE_LOAD_FAILED;
+        auto models = std::make_shared<SharedModels>();
+        models->detector_backend = backend;
+        models->face_cascade_path = cv::data::haarcascades + "haarcascade_frontalface_alt2.xml";
+        models->detector_model_path = model_path;
+        models->detector_input_size = input_size;
+        models->mask_model_path = mask_model_path;
+        models->stages = stages;
+        
+        // 加载OpenCV人脸检测模型（同时创建默认会话）
+        std::unique_ptr<FfSession> default_session;
+        int session_result = create_session(models, default_session);
+        if (session_result != FastFaceError::SUCCESS) {
+            return session_result;
         }
         
-        if (!g_eye_cascade.load(cv::data::haarcascades + "haarcascade_eye.xml")) {
+        if (!models->eye_cascade.load(cv::data::haarcascades + "haarcascade_eye.xml")) {
             return FastFaceError::EYE_CASCADE_LOAD_FAILED;
         }
         
-        // 初始化Facemark
-        g_facemark = cv::face::createFacemarkLBF();
-        std::string facemark_model = cv::data::face + "lbfmodel.yaml";
-        if (!g_facemark->loadModel(facemark_model)) {
-            // 如果加载失败，使用简化版本
-            g_facemark = nullptr;
+        // 初始化Facemark（不需要关键点时不加载），先加载一个实例，并发拟合时按需增加
+        // 加载失败时不输出关键点，使用简化版本
+        if (stages & FF_STAGE_LANDMARKS) {
+            models->facemarks.load(cv::data::face + "lbfmodel.yaml");
         }
         
         // 更新许可证信息
@@ -398,7 +2709,17 @@ int sdk_init(const char* license_key) {
         if (FastFaceConfig::ENABLE_TRIAL_MODE && key == "TRIAL_KEY") {
             init_trial_period();
         }
+        publish_license_snapshot(expiry);
         
+        if (!std::atomic_load(&g_worker_pool)) {
+            int thread_count = resolve_worker_thread_count(g_runtime_options.load()->worker_threads);
+            std::atomic_store(&g_worker_pool, std::make_shared<WorkerPool>(thread_count));
+        }
+        
+        g_models = models;
+        std::atomic_store(&g_default_session, std::shared_ptr<FfSession>(std::move(default_session)));
+        g_stream_sessions.clear();
+        g_idle_sessions.clear();
         g_activated = true;
         return FastFaceError::SUCCESS;
     } catch (...) {
@@ -407,139 +2728,450 @@ int sdk_init(const char* license_key) {
     }
 }
 
-int analyze_frame(const unsigned char* bgr_data, int width, int height, char* result_json, int json_buf_len) {
-    std::lock_guard<std::mutex> lock(g_mutex);
+int ff_session_create(FfSession** out_session) {
+    if (!out_session) return FastFaceError::INVALID_PARAMETERS;
+    *out_session = nullptr;
     
+    std::shared_ptr<const SharedModels> models;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (!g_activated) return FastFaceError::NOT_INITIALIZED;
+        models = g_models;
+    }
+    
+    try {
+        std::unique_ptr<FfSession> session;
+        int result = create_session(models, session);
+        if (result != FastFaceError::SUCCESS) return result;
+        
+        *out_session = session.release();
+        return FastFaceError::SUCCESS;
+    } catch (...) {
+        return FastFaceError::INIT_EXCEPTION;
+    }
+}
+
+int ff_session_analyze(FfSession* session, const unsigned char* bgr_data, int width, int height, char* result_json, int json_buf_len) {
     if (!g_activated) return FastFaceError::NOT_INITIALIZED;
-    if (!bgr_data || width <= 0 || height <= 0 || !result_json) return FastFaceError::INVALID_PARAMETERS;
+    if (!session || !bgr_data || width <= 0 || height <= 0 || !result_json) return FastFaceError::INVALID_PARAMETERS;
     
     // 检查许可证状态
-    if (!g_license_info.is_valid) return FastFaceError::INVALID_KEY;
-    if (is_key_expired(g_license_info.key)) return FastFaceError::KEY_EXPIRED;
-    if (g_license_info.is_trial && is_trial_expired()) return FastFaceError::TRIAL_EXPIRED;
+    std::shared_ptr<const LicenseSnapshot> license;
+    int license_result = check_license(license);
+    if (license_result != FastFaceError::SUCCESS) return license_result;
     
-    try {
-        // 创建OpenCV Mat
-        cv::Mat frame(height, width, CV_8UC3, (void*)bgr_data);
-        cv::Mat gray;
-        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
-        
-        // 运动模糊检测
-        double motion_blur = detect_motion_blur(gray, g_prev_gray);
-        g_prev_gray = gray.clone();
-        
-        // 人脸检测
-        std::vector<cv::Rect> faces;
-        g_face_cascade.detectMultiScale(gray, faces, 
-                                       FastFaceConfig::FACE_DETECTION_SCALE_FACTOR,
-                                       FastFaceConfig::FACE_DETECTION_MIN_NEIGHBORS, 
-                                       0, cv::Size(FastFaceConfig::FACE_DETECTION_MIN_SIZE, 
-                                                  FastFaceConfig::FACE_DETECTION_MIN_SIZE));
-        
-        nlohmann::json result;
-        result["code"] = FastFaceError::SUCCESS;
-        result["msg"] = "success";
-        
-        // 添加许可证信息
-        nlohmann::json license_info;
-        license_info["status"] = g_license_info.status;
-        license_info["expires"] = g_license_info.expires;
-        license_info["type"] = g_license_info.type;
-        if (g_license_info.is_trial) {
-            std::time_t now = std::time(nullptr);
-            int remaining_days = (g_license_info.trial_end - now) / (24 * 3600);
-            license_info["trial_remaining_days"] = std::max(0, remaining_days);
-        }
-        result["license_info"] = license_info;
-        
-        result["faces"] = nlohmann::json::array();
-        
-        for (const auto& face_rect : faces) {
-            // 更新历史记录
-            g_face_history.push_back(face_rect);
-            if (g_face_history.size() > FastFaceConfig::FACE_HISTORY_SIZE) {
-                g_face_history.pop_front();
-            }
-            
-            // 判断稳定性
-            bool is_stable = is_face_stable(face_rect, g_face_history);
-            
-            // 分析人脸特征
-            FaceMetrics metrics = analyze_face(frame, face_rect);
+    return run_session_analysis(*session, make_bgr_image(bgr_data, width, height), *license, result_json, json_buf_len, nullptr);
+}
+
+int ff_session_analyze_ex(FfSession* session, const FfImage* image, FfFaceResult* faces, int max_faces, int* face_count) {
+    if (!g_activated) return FastFaceError::NOT_INITIALIZED;
+    if (!session || !image || !face_count || max_faces < 0 || (!faces && max_faces > 0)) return FastFaceError::INVALID_PARAMETERS;
+    *face_count = 0;
+    
+    // 检查许可证状态
+    std::shared_ptr<const LicenseSnapshot> license;
+    int license_result = check_license(license);
+    if (license_result != FastFaceError::SUCCESS) return license_result;
+    
+    std::lock_guard<std::mutex> lock(session->mutex);
+    int result = analyze_session_image(*session, *image);
+    if (result != FastFaceError::SUCCESS) return result;
+    
+    return copy_face_results(session->results, faces, max_faces, face_count);
+}
+
+int ff_format_result_json(const FfFaceResult* faces, int face_count, char* result_json, int json_buf_len, int* required_size) {
+    if ((!result_json && json_buf_len > 0) || json_buf_len < 0 || face_count < 0 || (!faces && face_count > 0)) {
+        return FastFaceError::INVALID_PARAMETERS;
+    }
+    
+    std::shared_ptr<const LicenseSnapshot> license = g_license_snapshot.load();
+    if (!g_activated || !license) return FastFaceError::NOT_INITIALIZED;
+    
+    return format_result_json(faces, face_count, *license, result_json, json_buf_len, required_size);
+}
+
+int ff_session_get_result_json(FfSession* session, char* result_json, int json_buf_len, int* required_size) {
+    if (!g_activated) return FastFaceError::NOT_INITIALIZED;
+    if (!session || (!result_json && json_buf_len > 0) || json_buf_len < 0) return FastFaceError::INVALID_PARAMETERS;
+    
+    std::shared_ptr<const LicenseSnapshot> license;
+    int license_result = check_license(license);
+    if (license_result != FastFaceError::SUCCESS) return license_result;
+    
+    std::lock_guard<std::mutex> lock(session->mutex);
+    return format_result_json(session->results.data(), (int)session->results.size(), *license,
+                              result_json, json_buf_len, required_size);
+}
+
+int ff_session_analyze_image(FfSession* session, const FfImage* image, char* result_json, int json_buf_len) {
+    if (!g_activated) return FastFaceError::NOT_INITIALIZED;
+    if (!session || !image || !result_json) return FastFaceError::INVALID_PARAMETERS;
+    
+    // 检查许可证状态
+    std::shared_ptr<const LicenseSnapshot> license;
+    int license_result = check_license(license);
+    if (license_result != FastFaceError::SUCCESS) return license_result;
+    
+    return run_session_analysis(*session, *image, *license, result_json, json_buf_len, nullptr);
+}
+
+int ff_session_get_params(FfSession* session, FfSessionParams* params) {
+    if (!session || !params) return FastFaceError::INVALID_PARAMETERS;
+    
+    std::lock_guard<std::mutex> lock(session->mutex);
+    *params = session->params;
+    return FastFaceError::SUCCESS;
+}
+
+int ff_session_set_params(FfSession* session, const FfSessionParams* params) {
+    if (!session || !params) return FastFaceError::INVALID_PARAMETERS;
+    if (params->detection_interval < 1) return FastFaceError::INVALID_PARAMETERS;
+    if (params->min_track_confidence < 0.0 || params->min_track_confidence > 1.0) return FastFaceError::INVALID_PARAMETERS;
+    if (params->detection_scale <= 0.0 || params->detection_scale > 1.0 || params->detection_width < 0) {
+        return FastFaceError::INVALID_PARAMETERS;
+    }
+    if (params->full_scan_period < 1 || params->roi_expand_factor < 1.0) return FastFaceError::INVALID_PARAMETERS;
+    if (params->focal_length_x < 0.0 || params->focal_length_y < 0.0) return FastFaceError::INVALID_PARAMETERS;
+    if (params->landmark_tracking != 0 && params->landmark_tracking != 1) return FastFaceError::INVALID_PARAMETERS;
+    if (params->motion_estimator < FF_MOTION_FARNEBACK_FULL || params->motion_estimator > FF_MOTION_PHASE_CORRELATION) {
+        return FastFaceError::INVALID_PARAMETERS;
+    }
+    if (params->mask_interval < 1) return FastFaceError::INVALID_PARAMETERS;
+    if (params->low_light_mode < FF_LOW_LIGHT_OFF || params->low_light_mode > FF_LOW_LIGHT_ALWAYS) {
+        return FastFaceError::INVALID_PARAMETERS;
+    }
+    if (params->gate_min_face_size < 0 ||
+        params->gate_min_brightness_score < 0.0 || params->gate_min_brightness_score > 100.0 ||
+        params->gate_min_sharpness_score < 0.0 || params->gate_min_sharpness_score > 100.0) {
+        return FastFaceError::INVALID_PARAMETERS;
+    }
+    if (params->gated_stages & ~(FF_STAGE_LANDMARKS | FF_STAGE_POSE | FF_STAGE_MASK)) return FastFaceError::INVALID_PARAMETERS;
+    if (params->best_shot_count < 0 || params->best_shot_count > FastFaceConfig::BEST_SHOT_POOL_SIZE) {
+        return FastFaceError::INVALID_PARAMETERS;
+    }
+    // 只能启用初始化时可用的阶段（姿态依赖关键点，自动一并启用）
+    int stages = params->stages;
+    if (stages & FF_STAGE_POSE) stages |= FF_STAGE_LANDMARKS;
+    if (stages & ~session->models->stages) return FastFaceError::INVALID_PARAMETERS;
+    
+    std::lock_guard<std::mutex> lock(session->mutex);
+    session->params = *params;
+    session->params.stages = stages;
+    session->camera.frame_size = cv::Size();    // 内参可能变化，下一帧重建相机模型
+    return FastFaceError::SUCCESS;
+}
+
+int ff_session_get_alloc_count(FfSession* session, long long* count) {
+    if (!session || !count) return FastFaceError::INVALID_PARAMETERS;
+    *count = (long long)session->allocator.count();
+    return FastFaceError::SUCCESS;
+}
+
+int ff_session_poll_best_shot(FfSession* session, FfBestShot* shot, unsigned char* bgr_buf, int buf_len) {
+    if (!session || !shot) return FastFaceError::INVALID_PARAMETERS;
+    
+    std::lock_guard<std::mutex> lock(session->mutex);
+    if (session->ready_shots.empty()) return FastFaceError::NO_RESULT;
+    
+    const BestShot& ready = session->ready_shots.front();
+    shot->track_id = ready.track_id;
+    shot->frame_index = ready.frame_index;
+    shot->score = ready.score;
+    shot->face = ready.face;
+    shot->width = ready.width;
+    shot->height = ready.height;
+    if (!bgr_buf || buf_len < ready.width * ready.height * 3) return FastFaceError::BUFFER_TOO_SMALL;
+    
+    cv::Mat image(ready.height, ready.width, CV_8UC3, session->shot_storage[ready.slot].data);
+    cv::Mat output(ready.height, ready.width, CV_8UC3, bgr_buf);
+    image.copyTo(output);
+    session->free_shot_slots.push_back(ready.slot);
+    session->ready_shots.pop_front();
+    return FastFaceError::SUCCESS;
+}
+
+int ff_session_flush_best_shots(FfSession* session, int track_id) {
+    if (!session || track_id < 0) return FastFaceError::INVALID_PARAMETERS;
+    
+    std::lock_guard<std::mutex> lock(session->mutex);
+    finish_best_shots(*session, track_id);
+    return FastFaceError::SUCCESS;
+}
+
+void ff_session_destroy(FfSession* session) {
+    delete session;
+}
+
+int analyze_frame(const unsigned char* bgr_data, int width, int height, char* result_json, int json_buf_len) {
+    std::shared_ptr<FfSession> session = std::atomic_load(&g_default_session);
+    if (!g_activated || !session) return FastFaceError::NOT_INITIALIZED;
+    
+    return ff_session_analyze(session.get(), bgr_data, width, height, result_json, json_buf_len);
+}
+
+int analyze_frame_ex(const unsigned char* bgr_data, int width, int height, FfFaceResult* faces, int max_faces, int* face_count) {
+    std::shared_ptr<FfSession> session = std::atomic_load(&g_default_session);
+    if (!g_activated || !session) return FastFaceError::NOT_INITIALIZED;
+    if (!bgr_data) return FastFaceError::INVALID_PARAMETERS;
+    
+    FfImage image = make_bgr_image(bgr_data, width, height);
+    return ff_session_analyze_ex(session.get(), &image, faces, max_faces, face_count);
+}
+
+int get_last_result_json(char* result_json, int json_buf_len, int* required_size) {
+    std::shared_ptr<FfSession> session = std::atomic_load(&g_default_session);
+    if (!g_activated || !session) return FastFaceError::NOT_INITIALIZED;
+    
+    return ff_session_get_result_json(session.get(), result_json, json_buf_len, required_size);
+}
+
+int analyze_image(const FfImage* image, char* result_json, int json_buf_len) {
+    std::shared_ptr<FfSession> session = std::atomic_load(&g_default_session);
+    if (!g_activated || !session) return FastFaceError::NOT_INITIALIZED;
+    
+    return ff_session_analyze_image(session.get(), image, result_json, json_buf_len);
+}
+
+int analyze_frames(const FfFrameDesc* frames, int frame_count, FfJsonOutput* outputs) {
+    if (!g_activated) return FastFaceError::NOT_INITIALIZED;
+    if (!frames || !outputs || frame_count <= 0) return FastFaceError::INVALID_PARAMETERS;
+    
+    // 整批只检查一次许可证
+    std::shared_ptr<const LicenseSnapshot> license;
+    int license_result = check_license(license);
+    if (license_result != FastFaceError::SUCCESS) {
+        for (int i = 0; i < frame_count; ++i) outputs[i].status = license_result;
+        return license_result;
+    }
+    
+    std::shared_ptr<WorkerPool> pool = std::atomic_load(&g_worker_pool);
+    if (!g_activated || !pool) return FastFaceError::NOT_INITIALIZED;
+    
+    // 按视频流分组：同一路流的帧在同一任务中按数组顺序处理，无状态帧各自成组
+    std::vector<std::vector<int>> groups;
+    std::unordered_map<int, size_t> stream_groups;
+    for (int i = 0; i < frame_count; ++i) {
+        const FfFrameDesc& desc = frames[i];
+        FfImage image = frame_desc_image(desc);
+        if (!image.planes[0] || image.width <= 0 || image.height <= 0 || !outputs[i].result_json) {
+            outputs[i].status = FastFaceError::INVALID_PARAMETERS;
+            continue;
+        }
+        
+        if (desc.stream_id < 0) {
+            groups.push_back({i});
+            continue;
+        }
+        auto it = stream_groups.find(desc.stream_id);
+        if (it == stream_groups.end()) {
+            it = stream_groups.emplace(desc.stream_id, groups.size()).first;
+            groups.emplace_back();
+        }
+        groups[it->second].push_back(i);
+    }
+    
+    TaskLatch latch((int)groups.size());
+    for (const auto& group : groups) {
+        pool->submit([&, group]() {
+            int stream_id = frames[group.front()].stream_id;
+            std::shared_ptr<FfSession> stream_session;
+            std::unique_ptr<FfSession> idle_session;
             
-            // 头部姿态估计（简化版）
-            double yaw = 0.0, pitch = 0.0, roll = 0.0;
+            int result = stream_id < 0 ? acquire_idle_session(idle_session)
+                                       : acquire_stream_session(stream_id, stream_session);
+            FfSession* session = stream_id < 0 ? idle_session.get() : stream_session.get();
+            if (stream_id < 0 && session) reset_session_state(*session);
             
-            // 尝试使用Facemark进行关键点检测
-            if (g_facemark) {
-                std::vector<cv::Rect> face_rects = {face_rect};
-                std::vector<std::vector<cv::Point2f>> landmarks;
-                
-                if (g_facemark->fit(frame, face_rects, landmarks) && !landmarks.empty()) {
-                    std::tie(yaw, pitch, roll) = estimate_pose(landmarks[0], frame.size());
+            for (int index : group) {
+                if (result == FastFaceError::SUCCESS) {
+                    const FfFrameDesc& desc = frames[index];
+                    outputs[index].status = run_session_analysis(*session, frame_desc_image(desc), *license,
+                                                                 outputs[index].result_json, outputs[index].json_buf_len,
+                                                                 &outputs[index].required_size);
+                } else {
+                    outputs[index].status = result;
                 }
             }
             
-            // 构建人脸结果
-            nlohmann::json face_result;
-            face_result["bbox"] = {
-                {"x", face_rect.x},
-                {"y", face_rect.y},
-                {"width", face_rect.width},
-                {"height", face_rect.height}
-            };
-            
-            face_result["pose"] = {
-                {"yaw", yaw},
-                {"pitch", pitch},
-                {"roll", roll}
-            };
-            
-            face_result["metrics"] = {
-                {"sharpness", metrics.sharpness},
-                {"brightness", metrics.brightness},
-                {"has_mask", metrics.has_mask},
-                {"distance", metrics.distance}
-            };
-            
-            face_result["quality_scores"] = {
-                {"sharpness_score", sharpness_score(metrics.sharpness)},
-                {"brightness_score", brightness_score(metrics.brightness)},
-                {"contrast_score", contrast_score(gray)}
-            };
-            
-            face_result["stability"] = {
-                {"is_stable", is_stable},
-                {"motion_blur", motion_blur}
-            };
-            
-            result["faces"].push_back(face_result);
-        }
-        
-        // 转换为字符串
-        std::string json_str = result.dump();
-        if ((int)json_str.size() >= json_buf_len) return FastFaceError::BUFFER_TOO_SMALL;
-        
-        strcpy(result_json, json_str.c_str());
-        return FastFaceError::SUCCESS;
-        
+            if (idle_session) release_idle_session(std::move(idle_session));
+            latch.count_down();
+        });
+    }
+    latch.wait();
+    
+    // 返回第一个失败帧的错误代码
+    for (int i = 0; i < frame_count; ++i) {
+        if (outputs[i].status != FastFaceError::SUCCESS) return outputs[i].status;
+    }
+    return FastFaceError::SUCCESS;
+}
+
+int ff_submit_frame(const FfFrameDesc* frame, FfCompletionCallback callback, void* user_data, unsigned long long* out_ticket) {
+    if (!g_activated) return FastFaceError::NOT_INITIALIZED;
+    if (!frame) return FastFaceError::INVALID_PARAMETERS;
+    
+    std::shared_ptr<WorkerPool> pool = std::atomic_load(&g_worker_pool);
+    if (!g_activated || !pool) return FastFaceError::NOT_INITIALIZED;
+    
+    AsyncJob job;
+    job.stream_id = frame->stream_id;
+    job.callback = callback;
+    job.user_data = user_data;
+    
+    // 无锁占用一个在途名额
+    int max_in_flight = g_runtime_options.load()->max_in_flight;
+    int in_flight = g_in_flight.load();
+    do {
+        if (in_flight >= max_in_flight) return FastFaceError::QUEUE_FULL;
+    } while (!g_in_flight.compare_exchange_weak(in_flight, in_flight + 1));
+    
+    int copy_result;
+    try {
+        copy_result = copy_image(frame_desc_image(*frame), job.planes, job.image);
     } catch (...) {
-        return FastFaceError::ANALYSIS_EXCEPTION;
+        copy_result = FastFaceError::ANALYSIS_EXCEPTION;
+    }
+    if (copy_result != FastFaceError::SUCCESS) {
+        --g_in_flight;
+        return copy_result;
+    }
+    job.ticket = g_next_ticket++;
+    if (out_ticket) *out_ticket = job.ticket;
+    
+    if (job.stream_id < 0) {
+        // 无状态帧直接并行处理
+        auto shared_job = std::make_shared<AsyncJob>(std::move(job));
+        pool->submit([shared_job]() { process_async_job(*shared_job); });
+        return FastFaceError::SUCCESS;
+    }
+    
+    bool start_strand = false;
+    {
+        std::lock_guard<std::mutex> lock(g_async_mutex);
+        StreamStrand& strand = g_strands[job.stream_id];
+        strand.pending.push_back(std::move(job));
+        if (!strand.running) {
+            strand.running = true;
+            start_strand = true;
+        }
+    }
+    if (start_strand) {
+        int stream_id = frame->stream_id;
+        pool->submit([stream_id]() { drain_stream_strand(stream_id); });
+    }
+    return FastFaceError::SUCCESS;
+}
+
+int ff_poll_completion(unsigned long long* ticket, int* stream_id, int* status,
+                       char* result_json, int json_buf_len, int timeout_ms) {
+    if (!result_json || json_buf_len <= 0) return FastFaceError::INVALID_PARAMETERS;
+    
+    std::unique_lock<std::mutex> lock(g_async_mutex);
+    if (timeout_ms != 0) {
+        auto ready = []() { return !g_completions.empty(); };
+        if (timeout_ms < 0) {
+            g_completion_cv.wait(lock, ready);
+        } else {
+            g_completion_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready);
+        }
     }
+    if (g_completions.empty()) return FastFaceError::NO_RESULT;
+    
+    // 缓冲区不足时保留结果，调用方可换用更大的缓冲区重试
+    AsyncCompletion& completion = g_completions.front();
+    if ((int)completion.result_json.size() >= json_buf_len) return FastFaceError::BUFFER_TOO_SMALL;
+    
+    if (ticket) *ticket = completion.ticket;
+    if (stream_id) *stream_id = completion.stream_id;
+    if (status) *status = completion.status;
+    strcpy(result_json, completion.result_json.c_str());
+    
+    g_completions.pop_front();
+    --g_in_flight;
+    return FastFaceError::SUCCESS;
+}
+
+int ff_peek_completion_size(int* json_len) {
+    if (!json_len) return FastFaceError::INVALID_PARAMETERS;
+    
+    std::lock_guard<std::mutex> lock(g_async_mutex);
+    if (g_completions.empty()) return FastFaceError::NO_RESULT;
+    *json_len = (int)g_completions.front().result_json.size() + 1;
+    return FastFaceError::SUCCESS;
 }
 
-void sdk_release() {
+int ff_set_max_in_flight(int max_in_flight) {
+    if (max_in_flight <= 0) return FastFaceError::INVALID_PARAMETERS;
+    
     std::lock_guard<std::mutex> lock(g_mutex);
+    auto options = std::make_unique<RuntimeOptions>(*g_runtime_options.load());
+    options->max_in_flight = max_in_flight;
+    g_runtime_options.publish(std::move(options));
+    return FastFaceError::SUCCESS;
+}
+
+void ff_release_stream(int stream_id) {
+    std::shared_ptr<FfSession> session;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        auto it = g_stream_sessions.find(stream_id);
+        if (it == g_stream_sessions.end()) return;
+        session = std::move(it->second);
+        g_stream_sessions.erase(it);
+    }
+    // 在全局锁外析构，避免等待正在使用该会话的任务
+}
+
+int ff_set_worker_threads(int thread_count) {
+    // 旧线程池析构时等待全部工作线程退出，在工作线程上调用会等待自身
+    if (WorkerPool::current()) return FastFaceError::CALLED_FROM_WORKER;
+    
+    std::shared_ptr<WorkerPool> old_pool;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        auto options = std::make_unique<RuntimeOptions>(*g_runtime_options.load());
+        options->worker_threads = thread_count;
+        g_runtime_options.publish(std::move(options));
+        if (!g_activated) return FastFaceError::SUCCESS;
+        
+        try {
+            auto new_pool = std::make_shared<WorkerPool>(resolve_worker_thread_count(thread_count));
+            old_pool = std::atomic_exchange(&g_worker_pool, std::move(new_pool));
+        } catch (...) {
+            return FastFaceError::INIT_EXCEPTION;
+        }
+    }
+    // 旧线程池在锁外析构，正在执行的批次持有引用，完成后才会真正退出
+    return FastFaceError::SUCCESS;
+}
+
+int sdk_release() {
+    // 线程池析构时等待全部工作线程退出，在工作线程上调用会等待自身
+    if (WorkerPool::current()) return FastFaceError::CALLED_FROM_WORKER;
+    
+    std::shared_ptr<WorkerPool> pool;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        
+        // 已创建的会话持有模型引用，仍需调用方各自销毁
+        g_activated = false;
+        g_current_license_key.clear();
+        g_license_info = LicenseInfo();
+        g_license_snapshot.publish(nullptr);
+        g_models.reset();
+        std::atomic_store(&g_default_session, std::shared_ptr<FfSession>());
+        g_stream_sessions.clear();
+        g_idle_sessions.clear();
+        pool = std::atomic_exchange(&g_worker_pool, std::shared_ptr<WorkerPool>());
+    }
+    // 工作线程可能需要全局锁，在锁外等待其退出（未完成的异步任务以 -100 结束）
+    pool.reset();
     
-    g_activated = false;
-    g_current_license_key.clear();
-    g_license_info = LicenseInfo();
-    g_face_cascade = cv::CascadeClassifier();
-    g_eye_cascade = cv::CascadeClassifier();
-    g_facemark = nullptr;
-    g_mask_model = cv::dnn::Net();
-    g_face_history.clear();
-    g_prev_gray = cv::Mat();
+    std::lock_guard<std::mutex> lock(g_async_mutex);
+    g_completions.clear();
+    g_in_flight = 0;
+    return FastFaceError::SUCCESS;
 }
 
-} // extern "C" 
\ No newline at end of file
+} // extern "C"
@@ -1,5 +1,14 @@
 #include "include/fast_face_sdk.h"
 #include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <sstream>
 #include <opencv2/opencv.hpp>
 #include <nlohmann/json.hpp>
 
@@ -26,7 +35,101 @@ void print_analysis_results(const std::string& json_str) {
     }
 }
 
-int main() {
+// 失败的检查项数，非零时 main 返回1，供 CTest 判断
+static int g_failures = 0;
+
+// 输出一条失败的检查项并计数
+static std::ostream& report_failure() {
+    ++g_failures;
+    return std::cout << "   ✗ ";
+}
+
+// 两个人脸框的交并比
+static double box_iou(const FfRect& a, const FfRect& b) {
+    int x1 = std::max(a.x, b.x), y1 = std::max(a.y, b.y);
+    int x2 = std::min(a.x + a.width, b.x + b.width), y2 = std::min(a.y + a.height, b.y + b.height);
+    double inter = (double)std::max(0, x2 - x1) * std::max(0, y2 - y1);
+    double uni = (double)a.width * a.height + (double)b.width * b.height - inter;
+    return uni > 0.0 ? inter / uni : 0.0;
+}
+
+// 浮点结果在相对误差 1e-6 内视为相同（不同线程、不同模型实例的计算顺序可能不同）
+static bool nearly_equal(double a, double b) {
+    return std::abs(a - b) <= 1e-6 * std::max(1.0, std::max(std::abs(a), std::abs(b)));
+}
+
+// 按 configure 修改默认参数后创建会话，失败时返回空
+static FfSession* create_test_session(const std::function<void(FfSessionParams&)>& configure) {
+    FfSession* session = nullptr;
+    if (ff_session_create(&session) != 0) return nullptr;
+    FfSessionParams params;
+    ff_session_get_params(session, &params);
+    configure(params);
+    if (ff_session_set_params(session, &params) != 0) {
+        ff_session_destroy(session);
+        return nullptr;
+    }
+    return session;
+}
+
+// 在会话上分析一帧BGR图像，返回人脸数（不超过 MAX_FACES_PER_FRAME），失败时返回错误代码
+static int analyze_bgr(FfSession* session, const cv::Mat& image, FfFaceResult* faces) {
+    FfImage input = {FF_PIXEL_BGR, image.cols, image.rows, {image.data}, {(int)image.step}};
+    int count = 0;
+    int result = ff_session_analyze_ex(session, &input, faces, FastFaceConfig::MAX_FACES_PER_FRAME, &count);
+    return result != 0 ? result : std::min(count, FastFaceConfig::MAX_FACES_PER_FRAME);
+}
+
+// 用按 configure 配置的新会话分析一帧，用于与另一组参数的结果比较；会话创建失败时返回-1
+static int analyze_with_session(const std::function<void(FfSessionParams&)>& configure, const cv::Mat& image,
+                                FfFaceResult* faces) {
+    FfSession* session = create_test_session(configure);
+    if (!session) return -1;
+    int count = analyze_bgr(session, image, faces);
+    ff_session_destroy(session);
+    return count;
+}
+
+// 整幅图像水平平移 dx 像素，边缘复制填充
+static cv::Mat shift_image(const cv::Mat& image, double dx) {
+    cv::Mat shifted;
+    cv::Mat shift = (cv::Mat_<double>(2, 3) << 1, 0, dx, 0, 1, 0);
+    cv::warpAffine(image, shifted, shift, image.size(), cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+    return shifted;
+}
+
+// 输出测试标题并说明跳过原因
+static void skip_test(int number, const char* title, const std::string& reason) {
+    std::cout << "\n" << number << ". " << title << "..." << std::endl;
+    std::cout << "   - " << reason << "，跳过" << std::endl;
+}
+
+// 依赖真实人脸的测试：缺少人脸图像时跳过，否则按 configure 创建会话并运行 check，
+// check 返回是否通过，并把结果说明写入 detail
+static void run_face_test(int number, const char* title, const cv::Mat& face_image,
+                          const std::function<void(FfSessionParams&)>& configure,
+                          const std::function<bool(FfSession*, std::ostream&)>& check) {
+    if (face_image.empty()) {
+        skip_test(number, title, "缺少人脸测试图像");
+        return;
+    }
+    std::cout << "\n" << number << ". " << title << "..." << std::endl;
+    FfSession* session = create_test_session(configure);
+    if (!session) {
+        report_failure() << "会话创建失败" << std::endl;
+        return;
+    }
+    std::ostringstream detail;
+    bool passed = check(session, detail);
+    ff_session_destroy(session);
+    if (passed) {
+        std::cout << "   ✓ " << detail.str() << std::endl;
+    } else {
+        report_failure() << detail.str() << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
     std::cout << "FastFaceSDK 测试程序 (带密钥验证)" << std::endl;
     std::cout << "=================================" << std::endl;
     std::cout << "SDK版本: " << get_sdk_version() << std::endl;
@@ -39,7 +142,7 @@ int main() {
     if (verify_result != 0) {
         std::cout << "   ✓ 无效密钥被正确拒绝" << std::endl;
     } else {
-        std::cout << "   ✗ 无效密钥未被拒绝" << std::endl;
+        report_failure() << "无效密钥未被拒绝" << std::endl;
     }
     
     // 测试有效密钥
@@ -47,7 +150,7 @@ int main() {
     if (verify_result == 0) {
         std::cout << "   ✓ 有效密钥验证成功" << std::endl;
     } else {
-        std::cout << "   ✗ 有效密钥验证失败，错误代码: " << verify_result << std::endl;
+        report_failure() << "有效密钥验证失败，错误代码: " << verify_result << std::endl;
     }
     
     // 测试2: SDK初始化
@@ -56,7 +159,7 @@ int main() {
     if (init_result == 0) {
         std::cout << "   ✓ SDK初始化成功" << std::endl;
     } else {
-        std::cout << "   ✗ SDK初始化失败，错误代码: " << init_result << std::endl;
+        report_failure() << "SDK初始化失败，错误代码: " << init_result << std::endl;
         return -1;
     }
     
@@ -73,10 +176,10 @@ int main() {
             std::cout << "   类型: " << info["type"] << std::endl;
             std::cout << "   过期时间: " << info["expires"] << std::endl;
         } catch (const std::exception& e) {
-            std::cout << "   ✗ 许可证信息解析失败: " << e.what() << std::endl;
+            report_failure() << "许可证信息解析失败: " << e.what() << std::endl;
         }
     } else {
-        std::cout << "   ✗ 许可证信息获取失败，错误代码: " << license_result << std::endl;
+        report_failure() << "许可证信息获取失败，错误代码: " << license_result << std::endl;
     }
     
     // 测试4: 错误密钥初始化
@@ -85,7 +188,7 @@ int main() {
     if (wrong_key_result != 0) {
         std::cout << "   ✓ 错误密钥被正确拒绝" << std::endl;
     } else {
-        std::cout << "   ✗ 错误密钥未被拒绝" << std::endl;
+        report_failure() << "错误密钥未被拒绝" << std::endl;
     }
     
     // 重新初始化
@@ -98,7 +201,7 @@ int main() {
     if (empty_result != 0) {
         std::cout << "   ✓ 空图像被正确拒绝" << std::endl;
     } else {
-        std::cout << "   ✗ 空图像未被拒绝" << std::endl;
+        report_failure() << "空图像未被拒绝" << std::endl;
     }
     
     // 测试6: 创建测试图像
@@ -116,18 +219,685 @@ int main() {
         std::cout << "   ✓ 图像分析成功" << std::endl;
         print_analysis_results(result_json);
     } else {
-        std::cout << "   ✗ 图像分析失败，错误代码: " << analysis_result << std::endl;
+        report_failure() << "图像分析失败，错误代码: " << analysis_result << std::endl;
+    }
+    
+    // 含真实人脸的测试图像：由命令行参数指定，否则使用OpenCV示例数据中的 lena.jpg
+    // 合成图像检测不到人脸：没有该图像时在此记一次失败，依赖人脸的测试逐项跳过
+    std::string face_path = argc > 1 ? argv[1] : cv::samples::findFile("lena.jpg", false, true);
+    cv::Mat face_image = face_path.empty() ? cv::Mat() : cv::imread(face_path);
+    if (face_image.empty()) {
+        report_failure() << "未找到含人脸的测试图像，依赖人脸的测试将跳过，用法: test_sdk <人脸图像>" << std::endl;
+    }
+    
+    // 测试7: 多会话并行分析
+    std::cout << "\n7. 测试多会话并行分析..." << std::endl;
+    const int session_count = 4;
+    std::vector<FfSession*> sessions(session_count, nullptr);
+    bool sessions_ok = true;
+    for (int i = 0; i < session_count; ++i) {
+        if (ff_session_create(&sessions[i]) != 0) sessions_ok = false;
+    }
+    std::vector<int> session_results(session_count, -1);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < session_count && sessions_ok; ++i) {
+        workers.emplace_back([&, i]() {
+            char session_json[4096];
+            for (int frame = 0; frame < 5; ++frame) {
+                session_results[i] = ff_session_analyze(sessions[i], test_image.data, test_image.cols, test_image.rows,
+                                                        session_json, sizeof(session_json));
+                if (session_results[i] != 0) break;
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    for (int i = 0; i < session_count; ++i) {
+        if (session_results[i] != 0) sessions_ok = false;
+        ff_session_destroy(sessions[i]);
+    }
+    if (sessions_ok) {
+        std::cout << "   ✓ " << session_count << " 个会话并行分析成功" << std::endl;
+    } else {
+        report_failure() << "多会话并行分析失败" << std::endl;
+    }
+    
+    // 测试8: 批量分析
+    std::cout << "\n8. 测试批量分析..." << std::endl;
+    const int batch_size = 6;
+    std::vector<FfFrameDesc> batch_frames(batch_size);
+    std::vector<FfJsonOutput> batch_outputs(batch_size);
+    std::vector<std::vector<char>> batch_buffers(batch_size, std::vector<char>(4096));
+    for (int i = 0; i < batch_size; ++i) {
+        // 两路视频流加两帧无状态帧
+        batch_frames[i] = {test_image.data, test_image.cols, test_image.rows, i < 4 ? i % 2 : -1, nullptr};
+        batch_outputs[i] = {batch_buffers[i].data(), (int)batch_buffers[i].size(), -1, 0};
+    }
+    int batch_result = analyze_frames(batch_frames.data(), batch_size, batch_outputs.data());
+    bool batch_ok = batch_result == 0;
+    for (int i = 0; i < batch_size; ++i) {
+        if (batch_outputs[i].status != 0) batch_ok = false;
+    }
+    ff_release_stream(0);
+    ff_release_stream(1);
+    if (batch_ok) {
+        std::cout << "   ✓ 批量分析成功，共 " << batch_size << " 帧" << std::endl;
+    } else {
+        report_failure() << "批量分析失败，错误代码: " << batch_result << std::endl;
+    }
+    
+    // 测试9: 异步分析
+    std::cout << "\n9. 测试异步分析..." << std::endl;
+    const int async_count = 5;
+    std::vector<unsigned long long> submitted;
+    for (int i = 0; i < async_count; ++i) {
+        FfFrameDesc desc = {test_image.data, test_image.cols, test_image.rows, 7, nullptr};
+        unsigned long long ticket = 0;
+        if (ff_submit_frame(&desc, nullptr, nullptr, &ticket) == 0) submitted.push_back(ticket);
+    }
+    std::vector<unsigned long long> completed;
+    // 初始缓冲区故意过小：返回-9时按查询到的长度扩大后重取，结果不应丢失
+    std::vector<char> async_json(16);
+    int regrown = 0;
+    while (completed.size() < submitted.size()) {
+        unsigned long long ticket = 0;
+        int status = -1;
+        int poll_result = ff_poll_completion(&ticket, nullptr, &status, async_json.data(), (int)async_json.size(), 5000);
+        if (poll_result == FastFaceError::BUFFER_TOO_SMALL) {
+            int required = 0;
+            if (ff_peek_completion_size(&required) != 0 || required <= (int)async_json.size()) break;
+            async_json.resize(required);
+            ++regrown;
+            continue;
+        }
+        if (poll_result != 0) break;
+        if (status == 0) completed.push_back(ticket);
+    }
+    ff_release_stream(7);
+    // 同一视频流的结果应按提交顺序完成
+    if ((int)submitted.size() == async_count && completed == submitted && regrown > 0) {
+        std::cout << "   ✓ 异步分析成功，结果按提交顺序完成，缓冲区扩大 " << regrown << " 次" << std::endl;
+    } else {
+        report_failure() << "异步分析失败，完成 " << completed.size() << "/" << submitted.size() << " 帧" << std::endl;
+    }
+    
+    // 完成回调在工作线程上执行，其中重建线程池、重新初始化或释放SDK会等待自身，应被拒绝
+    std::atomic<int> callback_results[3] = {{1}, {1}, {1}};
+    FfFrameDesc callback_desc = {test_image.data, test_image.cols, test_image.rows, -1, nullptr};
+    FfCompletionCallback reenter_sdk = [](unsigned long long, int, int, const char*, void* user_data) {
+        std::atomic<int>* results = static_cast<std::atomic<int>*>(user_data);
+        results[1].store(sdk_init("FAST_FACE_2024_LICENSE_KEY_12345"));
+        results[2].store(sdk_release());
+        results[0].store(ff_set_worker_threads(2));
+    };
+    if (ff_submit_frame(&callback_desc, reenter_sdk, callback_results, nullptr) == 0) {
+        for (int i = 0; i < 500 && callback_results[0].load() == 1; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    if (callback_results[0].load() == FastFaceError::CALLED_FROM_WORKER &&
+        callback_results[1].load() == FastFaceError::CALLED_FROM_WORKER &&
+        callback_results[2].load() == FastFaceError::CALLED_FROM_WORKER) {
+        std::cout << "   ✓ 回调中重建线程池、重新初始化和释放SDK均被拒绝" << std::endl;
+    } else {
+        report_failure() << "回调中的调用未被拒绝，返回: " << callback_results[0].load() << ", "
+                         << callback_results[1].load() << ", " << callback_results[2].load() << std::endl;
+    }
+    
+    // 测试10: 多格式与带行跨度的输入
+    std::cout << "\n10. 测试多格式输入..." << std::endl;
+    cv::Mat gray_image;
+    cv::cvtColor(test_image, gray_image, cv::COLOR_BGR2GRAY);
+    // 灰度图放在更大缓冲区的子区域中，直接按行跨度传入
+    cv::Mat gray_canvas(gray_image.rows + 20, gray_image.cols + 64, CV_8UC1, cv::Scalar(0));
+    gray_image.copyTo(gray_canvas(cv::Rect(32, 10, gray_image.cols, gray_image.rows)));
+    FfImage gray_input = {};
+    gray_input.format = FF_PIXEL_GRAY;
+    gray_input.width = gray_image.cols;
+    gray_input.height = gray_image.rows;
+    gray_input.planes[0] = gray_canvas.ptr(10) + 32;
+    gray_input.strides[0] = (int)gray_canvas.step;
+    int gray_result = analyze_image(&gray_input, result_json, sizeof(result_json));
+    
+    cv::Mat i420_image;
+    cv::cvtColor(test_image, i420_image, cv::COLOR_BGR2YUV_I420);
+    FfImage i420_input = {};
+    i420_input.format = FF_PIXEL_I420;
+    i420_input.width = test_image.cols;
+    i420_input.height = test_image.rows;
+    i420_input.planes[0] = i420_image.data;
+    int i420_result = analyze_image(&i420_input, result_json, sizeof(result_json));
+    
+    FfImage odd_input = i420_input;
+    odd_input.width = test_image.cols - 1;
+    int odd_result = analyze_image(&odd_input, result_json, sizeof(result_json));
+    
+    if (gray_result == 0 && i420_result == 0 && odd_result == FastFaceError::INVALID_PARAMETERS) {
+        std::cout << "   ✓ 灰度(带行跨度)与I420输入分析成功，非法尺寸被正确拒绝" << std::endl;
+    } else {
+        report_failure() << "多格式输入失败，错误代码: " << gray_result << ", " << i420_result << ", " << odd_result << std::endl;
+    }
+    
+    // 测试11: 结构体结果
+    std::cout << "\n11. 测试结构体结果..." << std::endl;
+    FfFaceResult face_results[FastFaceConfig::MAX_FACES_PER_FRAME];
+    int face_count = -1;
+    int ex_result = analyze_frame_ex(test_image.data, test_image.cols, test_image.rows,
+                                     face_results, FastFaceConfig::MAX_FACES_PER_FRAME, &face_count);
+    int format_result = ex_result == 0 ? ff_format_result_json(face_results, face_count, result_json, sizeof(result_json), nullptr) : ex_result;
+    bool struct_ok = ex_result == 0 && format_result == 0 && face_count >= 0;
+    if (struct_ok) {
+        nlohmann::json formatted = nlohmann::json::parse(result_json);
+        struct_ok = (int)formatted["faces"].size() == face_count;
+    }
+    if (struct_ok) {
+        std::cout << "   ✓ 结构体结果获取成功，检测到 " << face_count << " 个人脸，JSON格式化一致" << std::endl;
+    } else {
+        report_failure() << "结构体结果获取失败，错误代码: " << ex_result << ", " << format_result << std::endl;
+    }
+    
+    // 测试12: 缓冲区不足时查询所需长度并重新获取
+    std::cout << "\n12. 测试缓冲区不足时重新获取结果..." << std::endl;
+    char small_json[16];
+    int small_result = analyze_frame(test_image.data, test_image.cols, test_image.rows, small_json, sizeof(small_json));
+    int required_size = 0;
+    int query_result = get_last_result_json(nullptr, 0, &required_size);
+    std::vector<char> retry_json(required_size > 0 ? required_size : 1);
+    int retry_result = get_last_result_json(retry_json.data(), (int)retry_json.size(), nullptr);
+    if (small_result == FastFaceError::BUFFER_TOO_SMALL && query_result == FastFaceError::BUFFER_TOO_SMALL &&
+        retry_result == 0 && (int)strlen(retry_json.data()) + 1 == required_size) {
+        std::cout << "   ✓ 所需长度 " << required_size << " 字节，重新获取成功" << std::endl;
+    } else {
+        report_failure() << "重新获取失败，错误代码: " << small_result << ", " << query_result << ", " << retry_result << std::endl;
+    }
+    
+    // 测试13: 检测-跟踪模式
+    std::cout << "\n13. 测试检测-跟踪模式..." << std::endl;
+    FfSession* track_session = nullptr;
+    if (face_image.empty()) {
+        std::cout << "   - 缺少人脸测试图像，跳过" << std::endl;
+    } else if (ff_session_create(&track_session) == 0) {
+        FfSessionParams params;
+        ff_session_get_params(track_session, &params);
+        FfSessionParams bad_params = params;
+        bad_params.detection_interval = 0;
+        int bad_result = ff_session_set_params(track_session, &bad_params);
+        params.detection_interval = 3;
+        int set_result = ff_session_set_params(track_session, &params);
+        
+        FfImage track_image = {FF_PIXEL_BGR, face_image.cols, face_image.rows, {face_image.data}, {0}};
+        FfFaceResult track_faces[FastFaceConfig::MAX_FACES_PER_FRAME];
+        int track_count = 0;
+        int frame_results[3];
+        int detected_faces = 0;
+        int tracked_faces = 0;
+        int max_track_id = 0;
+        for (int i = 0; i < 3; ++i) {
+            frame_results[i] = ff_session_analyze_ex(track_session, &track_image, track_faces,
+                                                     FastFaceConfig::MAX_FACES_PER_FRAME, &track_count);
+            for (int f = 0; f < std::min(track_count, FastFaceConfig::MAX_FACES_PER_FRAME); ++f) {
+                if (i == 0) ++detected_faces;
+                tracked_faces += track_faces[f].is_tracked;
+                max_track_id = std::max(max_track_id, track_faces[f].track_id);
+            }
+        }
+        // 第一帧检测到人脸，后两帧由跟踪得到；静止画面中同一人脸跨帧保持轨迹ID，ID总数不超过单帧人脸数
+        bool ids_stable = max_track_id > 0 && max_track_id <= detected_faces;
+        if (bad_result == FastFaceError::INVALID_PARAMETERS && set_result == 0 && detected_faces > 0 &&
+            tracked_faces > 0 && ids_stable && frame_results[0] == 0 && frame_results[1] == 0 && frame_results[2] == 0) {
+            std::cout << "   ✓ 检测间隔 3 帧，检测到人脸 " << detected_faces << " 个，跟踪得到的人脸框 "
+                      << tracked_faces << " 个，轨迹 " << max_track_id << " 条" << std::endl;
+        } else {
+            report_failure() << "检测-跟踪模式失败，错误代码: " << bad_result << ", " << set_result << ", "
+                      << frame_results[0] << "，检测 " << detected_faces << " 个，跟踪 " << tracked_faces
+                      << " 个，轨迹 " << max_track_id << " 条" << std::endl;
+        }
+        
+        // 质量门限：人脸框短边门限超过画面尺寸时，所有人脸跳过关键点、姿态和口罩阶段
+        params.gate_min_face_size = face_image.cols + face_image.rows;
+        ff_session_set_params(track_session, &params);
+        int gate_result = ff_session_analyze_ex(track_session, &track_image, track_faces,
+                                                FastFaceConfig::MAX_FACES_PER_FRAME, &track_count);
+        bool all_gated = track_count > 0;
+        for (int f = 0; f < std::min(track_count, FastFaceConfig::MAX_FACES_PER_FRAME); ++f) {
+            // 尺寸门限未通过时不在门限中计算清晰度，输出质量指标时仍应补算
+            all_gated = all_gated && track_faces[f].skipped_stages == (FF_STAGE_LANDMARKS | FF_STAGE_POSE | FF_STAGE_MASK) &&
+                        track_faces[f].sharpness > 0.0;
+        }
+        if (gate_result == 0 && all_gated) {
+            std::cout << "   ✓ 未通过质量门限的 " << track_count << " 个人脸已跳过后续阶段" << std::endl;
+        } else {
+            report_failure() << "质量门限未生效，错误代码: " << gate_result << "，人脸 " << track_count << " 个" << std::endl;
+        }
+        
+        // 尺寸和亮度门限通过后才计算清晰度，清晰度达标的人脸不跳过任何阶段
+        params.gate_min_face_size = 1;
+        params.gate_min_sharpness_score = 0.01;
+        ff_session_set_params(track_session, &params);
+        int sharp_result = ff_session_analyze_ex(track_session, &track_image, track_faces,
+                                                 FastFaceConfig::MAX_FACES_PER_FRAME, &track_count);
+        bool all_passed = track_count > 0;
+        for (int f = 0; f < std::min(track_count, FastFaceConfig::MAX_FACES_PER_FRAME); ++f) {
+            all_passed = all_passed && track_faces[f].skipped_stages == 0 && track_faces[f].sharpness > 0.0;
+        }
+        if (sharp_result == 0 && all_passed) {
+            std::cout << "   ✓ 通过清晰度门限的 " << track_count << " 个人脸执行全部阶段" << std::endl;
+        } else {
+            report_failure() << "清晰度门限异常，错误代码: " << sharp_result << "，人脸 " << track_count << " 个" << std::endl;
+        }
+        ff_session_destroy(track_session);
+    } else {
+        report_failure() << "会话创建失败" << std::endl;
+    }
+    
+    // 测试14: 稳态下会话缓冲区不再分配（只检查会话自有的缓冲区，OpenCV函数内部的临时内存不在计数内）
+    std::cout << "\n14. 测试稳态缓冲区复用..." << std::endl;
+    FfSession* pool_session = nullptr;
+    if (ff_session_create(&pool_session) == 0) {
+        // 有人脸时关键点、质量等逐人脸缓冲区也参与复用
+        const cv::Mat& pool_source = face_image.empty() ? test_image : face_image;
+        FfImage pool_image = {FF_PIXEL_BGR, pool_source.cols, pool_source.rows, {pool_source.data}, {(int)pool_source.step}};
+        FfFaceResult pool_faces[FastFaceConfig::MAX_FACES_PER_FRAME];
+        int pool_count = 0;
+        int pool_status = 0;
+        long long warm_allocs = 0, steady_allocs = 0;
+        
+        // 前两帧分配当前帧和上一帧的亮度平面等缓冲区
+        for (int i = 0; i < 3; ++i) {
+            pool_status |= ff_session_analyze_ex(pool_session, &pool_image, pool_faces,
+                                                 FastFaceConfig::MAX_FACES_PER_FRAME, &pool_count);
+        }
+        ff_session_get_alloc_count(pool_session, &warm_allocs);
+        for (int i = 0; i < 5; ++i) {
+            pool_status |= ff_session_analyze_ex(pool_session, &pool_image, pool_faces,
+                                                 FastFaceConfig::MAX_FACES_PER_FRAME, &pool_count);
+        }
+        ff_session_get_alloc_count(pool_session, &steady_allocs);
+        
+        if (pool_status == 0 && steady_allocs == warm_allocs) {
+            std::cout << "   ✓ 预热后会话缓冲区分配次数保持 " << steady_allocs << " 次（人脸 " << pool_count << " 个）" << std::endl;
+        } else {
+            report_failure() << "稳态下会话缓冲区仍有分配: " << warm_allocs << " -> " << steady_allocs
+                      << "，错误代码: " << pool_status << std::endl;
+        }
+        ff_session_destroy(pool_session);
+    } else {
+        report_failure() << "会话创建失败" << std::endl;
+    }
+    
+    // 测试15: 最佳抓拍（未启用姿态阶段时综合评分只由三项质量评分按权重归一化得到），以及槽位用尽时不挤掉未取走的结果
+    run_face_test(15, "测试最佳抓拍", face_image, [](FfSessionParams& p) {
+        p.best_shot_count = 2;
+        p.stages = FF_STAGE_QUALITY;
+    }, [&](FfSession* session, std::ostream& detail) {
+        FfFaceResult faces[FastFaceConfig::MAX_FACES_PER_FRAME];
+        int status = 0, face_total = 0;
+        for (int i = 0; i < 3; ++i) {
+            int count = analyze_bgr(session, face_image, faces);
+            if (count < 0) status |= count;
+            else face_total = count;
+        }
+        status |= ff_session_flush_best_shots(session, 0);
+        
+        // 先查询尺寸再取图像；每条轨迹最多2张
+        int shot_count = 0;
+        double worst_error = 0.0;
+        const double quality_weight = FastFaceConfig::BEST_SHOT_WEIGHT_SHARPNESS + FastFaceConfig::BEST_SHOT_WEIGHT_BRIGHTNESS +
+                                      FastFaceConfig::BEST_SHOT_WEIGHT_CONTRAST;
+        FfBestShot shot;
+        std::vector<unsigned char> pixels;
+        for (;;) {
+            int poll_result = ff_session_poll_best_shot(session, &shot, nullptr, 0);
+            if (poll_result == FastFaceError::NO_RESULT) break;
+            if (poll_result != FastFaceError::BUFFER_TOO_SMALL) {
+                status |= poll_result;
+                break;
+            }
+            pixels.resize((size_t)shot.width * shot.height * 3);
+            status |= ff_session_poll_best_shot(session, &shot, pixels.data(), (int)pixels.size());
+            double expected = (FastFaceConfig::BEST_SHOT_WEIGHT_SHARPNESS * shot.face.sharpness_score +
+                               FastFaceConfig::BEST_SHOT_WEIGHT_BRIGHTNESS * shot.face.brightness_score +
+                               FastFaceConfig::BEST_SHOT_WEIGHT_CONTRAST * shot.face.contrast_score) / quality_weight;
+            worst_error = std::max(worst_error, std::abs(shot.score - expected));
+            ++shot_count;
+        }
+        
+        // 不取走结果持续输出直到槽位用尽：新候选被丢弃，最早进入队列的结果保留
+        const int first_frame = 3;
+        const int rounds = face_total > 0 ? FastFaceConfig::BEST_SHOT_POOL_SIZE / face_total + 2 : 0;
+        for (int i = 0; i < rounds; ++i) {
+            int count = analyze_bgr(session, face_image, faces);
+            if (count < 0) status |= count;
+            status |= ff_session_flush_best_shots(session, 0);
+        }
+        int queued = 0, oldest_frame = -1;
+        pixels.resize(face_image.total() * 3);
+        while (ff_session_poll_best_shot(session, &shot, pixels.data(), (int)pixels.size()) == 0) {
+            if (queued++ == 0) oldest_frame = shot.frame_index;
+        }
+        detail << "人脸 " << face_total << " 个，最佳抓拍 " << shot_count << " 张，不含姿态项的评分误差 " << worst_error
+               << "；槽位用尽后队列 " << queued << " 张，最早一张来自第 " << oldest_frame << " 帧，错误代码 " << status;
+        return status == 0 && face_total > 0 && shot_count > 0 && shot_count <= face_total * 2 && worst_error < 1e-9 &&
+               queued == FastFaceConfig::BEST_SHOT_POOL_SIZE && oldest_frame == first_frame;
+    });
+    
+    // 测试16: 只启用部分分析阶段，未启用阶段的字段从结果中省略
+    run_face_test(16, "测试分析阶段选择", face_image, [](FfSessionParams& p) {
+        p.stages = FF_STAGE_QUALITY;            // 只输出人脸框、轨迹和质量指标
+    }, [&](FfSession* session, std::ostream& detail) {
+        FfSessionParams invalid;
+        ff_session_get_params(session, &invalid);
+        invalid.stages = 1 << 6;                // 未定义的阶段
+        bool rejected = ff_session_set_params(session, &invalid) == FastFaceError::INVALID_PARAMETERS;
+        
+        char json[4096];
+        int status = ff_session_analyze(session, face_image.data, face_image.cols, face_image.rows, json, sizeof(json));
+        int face_count = 0;
+        bool omitted = true;
+        if (status == 0) {
+            for (const auto& face : nlohmann::json::parse(json)["faces"]) {
+                omitted = omitted && !face.contains("pose") && face.contains("quality_scores") &&
+                          !face.contains("stability") && !face["metrics"].contains("has_mask");
+                ++face_count;
+            }
+        }
+        detail << "人脸 " << face_count << " 个，未定义阶段" << (rejected ? "被拒绝" : "未被拒绝")
+               << "，未启用阶段的字段" << (omitted ? "已省略" : "仍输出") << "，错误代码 " << status;
+        return rejected && status == 0 && face_count > 0 && omitted;
+    });
+    
+    // 测试17: 缩小检测，缩小检测得到的每个人脸框都应与原分辨率检测的某个人脸框基本重合
+    run_face_test(17, "测试检测缩放", face_image, [](FfSessionParams& p) { p.detection_scale = 0.5; },
+                  [&](FfSession* session, std::ostream& detail) {
+        // 放大一倍，使缩小检测后人脸仍大于最小检测尺寸
+        cv::Mat large_face;
+        cv::resize(face_image, large_face, cv::Size(), 2.0, 2.0, cv::INTER_LINEAR);
+        FfFaceResult full_faces[FastFaceConfig::MAX_FACES_PER_FRAME];
+        FfFaceResult scaled_faces[FastFaceConfig::MAX_FACES_PER_FRAME];
+        int full_count = analyze_with_session([](FfSessionParams&) {}, large_face, full_faces);
+        int scaled_count = analyze_bgr(session, large_face, scaled_faces);
+        
+        bool mapped = full_count > 0 && scaled_count > 0;
+        for (int i = 0; mapped && i < scaled_count; ++i) {
+            double best = 0.0;
+            for (int j = 0; j < full_count; ++j) best = std::max(best, box_iou(scaled_faces[i].bbox, full_faces[j].bbox));
+            mapped = best >= 0.5;
+        }
+        detail << "原分辨率 " << full_count << " 个人脸，0.5 倍检测 " << scaled_count << " 个"
+               << (mapped ? "，人脸框重合" : "，人脸框不重合");
+        return mapped;
+    });
+    
+    // 测试18: 两次全画面检测之间只在已知人脸附近检测
+    run_face_test(18, "测试局部窗口检测", face_image, [](FfSessionParams& p) { p.full_scan_period = 3; },
+                  [&](FfSession* session, std::ostream& detail) {
+        FfFaceResult first_faces[FastFaceConfig::MAX_FACES_PER_FRAME];
+        FfFaceResult roi_faces[FastFaceConfig::MAX_FACES_PER_FRAME];
+        int first_count = analyze_bgr(session, face_image, first_faces);
+        int roi_count = analyze_bgr(session, face_image, roi_faces);
+        
+        // 第二帧只扫描窗口，应找回同一人脸；随后纯色帧的窗口被跳过，回退全画面检测也找不到人脸
+        bool same_face = first_count > 0 && roi_count == first_count &&
+                         box_iou(first_faces[0].bbox, roi_faces[0].bbox) >= 0.5 &&
+                         first_faces[0].track_id == roi_faces[0].track_id;
+        cv::Mat flat_image(face_image.size(), CV_8UC3, cv::Scalar(90, 90, 90));
+        int flat_count = analyze_bgr(session, flat_image, roi_faces);
+        detail << "全画面 " << first_count << " 个人脸，窗口内找回 " << roi_count << " 个，纯色画面 " << flat_count << " 个";
+        return same_face && flat_count == 0;
+    });
+    
+    // 测试19: YuNet检测后端（需要ONNX模型文件），竖长画面检测时不应被压扁
+    FfInitOptions yunet_options = {FF_DETECTOR_YUNET, nullptr, 0, 0, nullptr, 0};
+    int yunet_init = sdk_init_ex("FAST_FACE_2024_LICENSE_KEY_12345", &yunet_options);
+    if (yunet_init == FastFaceError::FACE_CASCADE_LOAD_FAILED) {
+        skip_test(19, "测试YuNet检测后端", std::string("模型目录中未找到YuNet模型文件 ") + FastFaceConfig::YUNET_MODEL_FILE);
+    } else {
+        run_face_test(19, "测试YuNet检测后端", face_image, [](FfSessionParams&) {},
+                      [&](FfSession* session, std::ostream& detail) {
+            // 人脸图像下方补一倍高度
+            cv::Mat tall_image(face_image.rows * 2, face_image.cols, CV_8UC3, cv::Scalar(90, 90, 90));
+            face_image.copyTo(tall_image(cv::Rect(0, 0, face_image.cols, face_image.rows)));
+            FfFaceResult faces[FastFaceConfig::MAX_FACES_PER_FRAME];
+            int count = analyze_bgr(session, face_image, faces);
+            int tall_count = analyze_bgr(session, tall_image, faces);
+            detail << "初始化 " << yunet_init << "，YuNet检测到 " << count << " 个人脸，竖长画面 " << tall_count << " 个";
+            return yunet_init == 0 && count > 0 && tall_count > 0;
+        });
     }
+    sdk_init("FAST_FACE_2024_LICENSE_KEY_12345");
+    
+    // 测试20: LBP快速检测后端
+    FfInitOptions lbp_options = {FF_DETECTOR_LBP, nullptr, 0, 0, nullptr, 0};
+    int lbp_init = sdk_init_ex("FAST_FACE_2024_LICENSE_KEY_12345", &lbp_options);
+    run_face_test(20, "测试LBP检测后端", face_image, [](FfSessionParams&) {}, [&](FfSession* session, std::ostream& detail) {
+        FfFaceResult faces[FastFaceConfig::MAX_FACES_PER_FRAME];
+        int count = analyze_bgr(session, face_image, faces);
+        detail << "初始化 " << lbp_init << "，LBP级联检测到 " << count << " 个人脸";
+        return lbp_init == 0 && count > 0;
+    });
+    sdk_init("FAST_FACE_2024_LICENSE_KEY_12345");
+    
+    // 测试21: 单帧多个人脸并行分析（含逐人脸的关键点拟合）；同一人脸左右各放一份，两个会话的结果应逐项一致
+    run_face_test(21, "测试单帧多人脸并行分析", face_image, [](FfSessionParams&) {},
+                  [&](FfSession* session, std::ostream& detail) {
+        cv::Mat pair_image;
+        cv::hconcat(face_image, face_image, pair_image);
+        FfFaceResult pair_a[FastFaceConfig::MAX_FACES_PER_FRAME];
+        FfFaceResult pair_b[FastFaceConfig::MAX_FACES_PER_FRAME];
+        int count_a = analyze_bgr(session, pair_image, pair_a);
+        int count_b = analyze_with_session([](FfSessionParams&) {}, pair_image, pair_b);
+        bool identical = count_a >= 2 && count_a == count_b;
+        for (int i = 0; identical && i < count_a; ++i) {
+            identical = box_iou(pair_a[i].bbox, pair_b[i].bbox) == 1.0 && pair_a[i].has_mask == pair_b[i].has_mask &&
+                        nearly_equal(pair_a[i].yaw, pair_b[i].yaw) && nearly_equal(pair_a[i].pitch, pair_b[i].pitch) &&
+                        nearly_equal(pair_a[i].distance, pair_b[i].distance) &&
+                        nearly_equal(pair_a[i].sharpness, pair_b[i].sharpness);
+        }
+        detail << "两个会话分别检测到 " << count_a << " / " << count_b << " 个人脸，结果"
+               << (identical ? "顺序和数值一致" : "不一致");
+        return identical;
+    });
+    
+    // 测试22: 只设置焦距时主点仍取图像中心；焦距等于图像宽度时与默认相机模型相同，姿态应一致
+    const double focal = face_image.cols;
+    run_face_test(22, "测试相机内参", face_image, [focal](FfSessionParams& p) { p.focal_length_x = focal; },
+                  [&](FfSession* session, std::ostream& detail) {
+        FfFaceResult default_pose[FastFaceConfig::MAX_FACES_PER_FRAME];
+        FfFaceResult focal_pose[FastFaceConfig::MAX_FACES_PER_FRAME];
+        int default_count = analyze_with_session([](FfSessionParams&) {}, face_image, default_pose);
+        int focal_count = analyze_bgr(session, face_image, focal_pose);
+        bool has_pose = default_count > 0 &&
+                        (default_pose[0].yaw != 0.0 || default_pose[0].pitch != 0.0 || default_pose[0].roll != 0.0);
+        if (!has_pose) {
+            detail << "未得到头部姿态（检查LBF关键点模型 lbfmodel.yaml），人脸 " << default_count << " 个";
+            return false;
+        }
+        bool same_pose = focal_count == default_count && nearly_equal(focal_pose[0].yaw, default_pose[0].yaw) &&
+                         nearly_equal(focal_pose[0].pitch, default_pose[0].pitch) &&
+                         nearly_equal(focal_pose[0].roll, default_pose[0].roll) &&
+                         nearly_equal(focal_pose[0].distance, default_pose[0].distance);
+        detail << "默认相机 yaw " << default_pose[0].yaw << "，只设置焦距 yaw " << focal_pose[0].yaw
+               << "，pitch " << default_pose[0].pitch << " / " << focal_pose[0].pitch;
+        return same_pose;
+    });
+    
+    // 测试23: 关键点跨帧跟踪，超过间隔后重新拟合
+    run_face_test(23, "测试关键点跟踪", face_image, [](FfSessionParams& p) { p.landmark_tracking = 1; },
+                  [&](FfSession* session, std::ostream& detail) {
+        // 画面每帧平移2像素，跟踪得到的姿态应与首帧拟合结果接近，且跨过一次强制重新拟合
+        FfFaceResult faces[FastFaceConfig::MAX_FACES_PER_FRAME];
+        double first_yaw = 0.0, max_deviation = 0.0;
+        int frames = 0;
+        for (int i = 0; i <= FastFaceConfig::LANDMARK_REFIT_INTERVAL + 1; ++i) {
+            if (analyze_bgr(session, shift_image(face_image, 2.0 * i), faces) <= 0) break;
+            if (i == 0) first_yaw = faces[0].yaw;
+            max_deviation = std::max(max_deviation, std::abs(faces[0].yaw - first_yaw));
+            ++frames;
+        }
+        detail << "完成 " << frames << " 帧跟踪，首帧 yaw " << first_yaw << "，最大偏差 " << max_deviation << " 度";
+        return frames == FastFaceConfig::LANDMARK_REFIT_INTERVAL + 2 && first_yaw != 0.0 && max_deviation < 5.0;
+    });
     
-    // 测试7: 保存测试图像
+    // 测试24: 各运动估计方法；第二帧整体右移4像素，估计的人脸运动幅度与4的误差都应在 MOTION_ERROR_TOLERANCE 以内
+    run_face_test(24, "测试运动估计方法", face_image, [](FfSessionParams&) {}, [&](FfSession*, std::ostream& detail) {
+        cv::Mat moved_face = shift_image(face_image, 4.0);
+        const int estimators[] = {FF_MOTION_FARNEBACK_FULL, FF_MOTION_FARNEBACK_DOWNSCALED,
+                                  FF_MOTION_SPARSE_LK, FF_MOTION_PHASE_CORRELATION};
+        bool motion_ok = true;
+        detail << "运动幅度（完整/缩小Farneback、LK、相位相关）:";
+        for (int estimator : estimators) {
+            FfSession* motion_session = create_test_session([estimator](FfSessionParams& p) { p.motion_estimator = estimator; });
+            FfFaceResult faces[FastFaceConfig::MAX_FACES_PER_FRAME];
+            int count = motion_session ? analyze_bgr(motion_session, face_image, faces) : -1;
+            if (count > 0) count = analyze_bgr(motion_session, moved_face, faces);
+            double blur = count > 0 ? faces[0].motion_blur : -1.0;
+            motion_ok = motion_ok && std::abs(blur - 4.0) < FastFaceConfig::MOTION_ERROR_TOLERANCE;
+            detail << " " << blur;
+            if (motion_session) ff_session_destroy(motion_session);
+        }
+        return motion_ok;
+    });
+    
+    // 测试25: 单次遍历的质量指标与OpenCV参考实现一致
+    run_face_test(25, "测试质量指标计算", face_image, [](FfSessionParams&) {}, [&](FfSession* session, std::ostream& detail) {
+        FfFaceResult faces[FastFaceConfig::MAX_FACES_PER_FRAME];
+        int count = analyze_bgr(session, face_image, faces);
+        
+        // 参考值：CV_64F 拉普拉斯响应的方差，以及人脸区域亮度均值
+        cv::Mat face_gray;
+        cv::cvtColor(face_image, face_gray, cv::COLOR_BGR2GRAY);
+        double worst_error = 0.0;
+        for (int i = 0; i < count; ++i) {
+            const FfRect& box = faces[i].bbox;
+            // 复制为独立图像，边界按区域自身反射（与SDK相同），不读取区域外的像素
+            cv::Mat roi = face_gray(cv::Rect(box.x, box.y, box.width, box.height)).clone();
+            cv::Mat laplacian;
+            cv::Laplacian(roi, laplacian, CV_64F, 1);
+            cv::Scalar lap_mean, lap_stddev, mean, stddev;
+            cv::meanStdDev(laplacian, lap_mean, lap_stddev);
+            cv::meanStdDev(roi, mean, stddev);
+            double sharpness_error = std::abs(faces[i].sharpness - lap_stddev[0] * lap_stddev[0]) /
+                                     std::max(1.0, lap_stddev[0] * lap_stddev[0]);
+            double brightness_error = std::abs(faces[i].brightness - mean[0]) / std::max(1.0, mean[0]);
+            worst_error = std::max(worst_error, std::max(sharpness_error, brightness_error));
+        }
+        detail << "人脸 " << count << " 个，清晰度和亮度与 cv::Laplacian / meanStdDev 的最大相对误差 " << worst_error;
+        return count > 0 && worst_error < 1e-9;
+    });
+    
+    // 测试26: 多个人脸的对比度评分应与按区域直接计算的标准差换算结果一致
+    run_face_test(26, "测试多人脸亮度统计", face_image, [](FfSessionParams&) {}, [&](FfSession* session, std::ostream& detail) {
+        cv::Mat pair_image, pair_gray;
+        cv::hconcat(face_image, face_image, pair_image);
+        cv::cvtColor(pair_image, pair_gray, cv::COLOR_BGR2GRAY);
+        FfFaceResult faces[FastFaceConfig::MAX_FACES_PER_FRAME];
+        int count = analyze_bgr(session, pair_image, faces);
+        double worst_error = 0.0;
+        for (int i = 0; i < count; ++i) {
+            const FfRect& box = faces[i].bbox;
+            cv::Scalar mean, stddev;
+            cv::meanStdDev(pair_gray(cv::Rect(box.x, box.y, box.width, box.height)), mean, stddev);
+            double expected = std::min(100.0, std::max(0.0, (stddev[0] - 20.0) / 80.0 * 100.0));
+            worst_error = std::max(worst_error, std::abs(faces[i].contrast_score - expected));
+        }
+        detail << "人脸 " << count << " 个，对比度评分与逐区域计算的最大误差 " << worst_error;
+        return count >= 2 && worst_error < 1e-6;
+    });
+    
+    // 测试27: 口罩分类配置：缺失的模型文件和为0的分类间隔应被拒绝
+    std::cout << "\n27. 测试口罩分类配置..." << std::endl;
+    FfInitOptions mask_options = {FF_DETECTOR_HAAR, nullptr, 0, 0, "missing_mask_model.onnx", 0};
+    int mask_init = sdk_init_ex("FAST_FACE_2024_LICENSE_KEY_12345", &mask_options);
+    sdk_init("FAST_FACE_2024_LICENSE_KEY_12345");
+    FfSession* zero_interval = create_test_session([](FfSessionParams& p) { p.mask_interval = 0; });
+    if (mask_init == FastFaceError::MASK_MODEL_LOAD_FAILED && !zero_interval) {
+        std::cout << "   ✓ 缺失的口罩模型和为0的分类间隔被拒绝" << std::endl;
+    } else {
+        report_failure() << "配置检查失败，模型: " << mask_init << "，间隔为0时会话" << (zero_interval ? "被接受" : "被拒绝") << std::endl;
+    }
+    if (zero_interval) ff_session_destroy(zero_interval);
+    
+    // 测试28: 未配置模型时使用颜色启发式，未戴口罩的人脸在分类间隔内外结果应一致
+    run_face_test(28, "测试口罩判定", face_image, [](FfSessionParams& p) { p.mask_interval = 3; },
+                  [&](FfSession* session, std::ostream& detail) {
+        FfFaceResult faces[FastFaceConfig::MAX_FACES_PER_FRAME];
+        int count = 0, masked = 0;
+        for (int frame = 0; frame < 4; ++frame) {
+            count = analyze_bgr(session, face_image, faces);
+            if (count <= 0) break;
+            for (int i = 0; i < count; ++i) masked += faces[i].has_mask;
+        }
+        detail << "连续4帧，人脸 " << count << " 个，判定佩戴口罩 " << masked << " 次";
+        return count > 0 && masked == 0;
+    });
+    
+    // 测试29: 暗光画面的低照度增强；增强后应能检出人脸，且不少于不增强时
+    run_face_test(29, "测试低照度增强", face_image, [](FfSessionParams&) {}, [&](FfSession*, std::ostream& detail) {
+        cv::Mat dark_image;
+        face_image.convertTo(dark_image, -1, 0.15, 0.0);
+        const int modes[3] = {FF_LOW_LIGHT_OFF, FF_LOW_LIGHT_AUTO, FF_LOW_LIGHT_ALWAYS};
+        int counts[3];
+        FfFaceResult faces[FastFaceConfig::MAX_FACES_PER_FRAME];
+        for (int m = 0; m < 3; ++m) {
+            counts[m] = analyze_with_session([&](FfSessionParams& p) { p.low_light_mode = modes[m]; }, dark_image, faces);
+        }
+        detail << "暗光画面检测人脸数 关闭/自动/始终: " << counts[0] << "/" << counts[1] << "/" << counts[2];
+        return counts[1] > 0 && counts[2] > 0 && counts[1] >= counts[0];
+    });
+    
+    // 测试30: 多个人脸平移时轨迹ID按位置关联
+    run_face_test(30, "测试多人脸轨迹关联", face_image, [](FfSessionParams&) {}, [&](FfSession* session, std::ostream& detail) {
+        cv::Mat pair_image;
+        cv::hconcat(face_image, face_image, pair_image);
+        FfFaceResult faces[FastFaceConfig::MAX_FACES_PER_FRAME];
+        int half_ids[2] = {0, 0};
+        int frames = 0;
+        bool stable = true;
+        for (int i = 0; i < 8; ++i) {
+            // 每帧整体右移3像素，左右两半各自的人脸应保持原轨迹ID
+            int count = analyze_bgr(session, shift_image(pair_image, 3.0 * i), faces);
+            if (count < 2) break;
+            for (int k = 0; k < count; ++k) {
+                int half = faces[k].bbox.x + faces[k].bbox.width / 2 < face_image.cols + 3 * i ? 0 : 1;
+                if (half_ids[half] == 0 && i == 0) half_ids[half] = faces[k].track_id;
+                else if (faces[k].track_id != half_ids[half]) stable = false;
+            }
+            ++frames;
+        }
+        detail << "完成 " << frames << " 帧，轨迹ID " << half_ids[0] << "/" << half_ids[1] << (stable ? "，保持不变" : "，发生变化");
+        return frames == 8 && stable && half_ids[0] > 0 && half_ids[1] > 0 && half_ids[0] != half_ids[1];
+    });
+    
+    // 测试31: 检测模型路径，指定的文件不存在时初始化失败并返回-4
+    std::cout << "\n31. 测试检测模型路径..." << std::endl;
+    FfInitOptions missing_lbp = {FF_DETECTOR_LBP, "missing_lbp_cascade.xml", 0, 0, nullptr, 0};
+    FfInitOptions missing_yunet = {FF_DETECTOR_YUNET, "missing_yunet_model.onnx", 0, 0, nullptr, 0};
+    int missing_lbp_init = sdk_init_ex("FAST_FACE_2024_LICENSE_KEY_12345", &missing_lbp);
+    int missing_yunet_init = sdk_init_ex("FAST_FACE_2024_LICENSE_KEY_12345", &missing_yunet);
+    sdk_init("FAST_FACE_2024_LICENSE_KEY_12345");
+    if (missing_lbp_init == FastFaceError::FACE_CASCADE_LOAD_FAILED &&
+        missing_yunet_init == FastFaceError::FACE_CASCADE_LOAD_FAILED) {
+        std::cout << "   ✓ 不存在的LBP级联和YuNet模型路径均返回 -4" << std::endl;
+    } else {
+        report_failure() << "模型路径检查失败，LBP: " << missing_lbp_init << "，YuNet: " << missing_yunet_init << std::endl;
+    }
+    
+    // 测试32: 保存测试图像
     cv::imwrite("test_image.jpg", test_image);
-    std::cout << "\n7. 测试图像已保存为 test_image.jpg" << std::endl;
+    std::cout << "\n32. 测试图像已保存为 test_image.jpg" << std::endl;
     
-    // 测试8: 释放资源
-    std::cout << "\n8. 测试资源释放..." << std::endl;
-    sdk_release();
-    std::cout << "   ✓ 资源释放完成" << std::endl;
+    // 测试33: 释放资源
+    std::cout << "\n33. 测试资源释放..." << std::endl;
+    int release_result = sdk_release();
+    if (release_result == 0) {
+        std::cout << "   ✓ 资源释放完成" << std::endl;
+    } else {
+        report_failure() << "资源释放失败，错误代码: " << release_result << std::endl;
+    }
     
+    if (g_failures > 0) {
+        std::cout << "\n测试完成，" << g_failures << " 项失败" << std::endl;
+        return 1;
+    }
     std::cout << "\n所有测试完成！" << std::endl;
     return 0;
 } 
\ No newline at end of file